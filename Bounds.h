@@ -0,0 +1,197 @@
+#pragma once
+#include "Vec3.h"
+#include "Mat4.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+// =============================================================================
+// Bounds: Bounding volumes and frustum tests (for culling)
+// =============================================================================
+// THE IDEA:
+// Before spending ANY work on a mesh (transforming vertices, issuing a draw
+// call, rasterizing), ask a much cheaper question: could it possibly be
+// visible? Wrap the mesh in a simple shape and test that shape against the
+// camera's view volume (the FRUSTUM). If the shape is fully outside, so is
+// every triangle inside it.
+//
+// TWO SHAPES:
+// - AABB (axis-aligned bounding box): min/max corner. Tight for boxy
+//   meshes, and transformable without touching the vertices (see
+//   transformed)
+// - Bounding sphere: center + radius. Loosest fit, but the test is one
+//   dot product per plane
+//
+// Both are computed ONCE per mesh in object space (Mesh::computeBounds)
+// and moved to world space per draw with the model matrix.
+//
+// CONSERVATIVE:
+// The tests may call an invisible object visible (near frustum corners)
+// but NEVER the other way round - a wrong "outside" would make objects pop.
+// =============================================================================
+
+// =============================================================================
+// AABB
+// =============================================================================
+struct AABB {
+    // Default = EMPTY (min > max): contains nothing, not even a point
+    Vec3 min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+             std::numeric_limits<float>::max()};
+    Vec3 max{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+             std::numeric_limits<float>::lowest()};
+
+    bool isEmpty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    void expand(const Vec3& point) {
+        min = Vec3(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+        max = Vec3(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+    }
+
+    void expand(const AABB& other) {
+        if (other.isEmpty()) return;
+        expand(other.min);
+        expand(other.max);
+    }
+
+    Vec3 center() const { return (min + max) * 0.5f; }
+    Vec3 extents() const { return (max - min) * 0.5f; }  // Half-size per axis
+
+    // ==========================================================================
+    // TRANSFORMED (Arvo's method)
+    // Box of the transformed box, without transforming its 8 corners:
+    // the center moves like a point, and each new half-extent is the sum of
+    // the old extents weighted by |matrix entries| (how much every old
+    // axis leans into the new one).
+    // ==========================================================================
+    AABB transformed(const Mat4& matrix) const {
+        if (isEmpty()) return {};
+
+        Vec3 c = matrix.transformPoint(center());
+        Vec3 e = extents();
+        const float* m = matrix.m;  // Column-major: m[column * 4 + row]
+
+        Vec3 worldExtents(
+            std::fabs(m[0]) * e.x + std::fabs(m[4]) * e.y + std::fabs(m[8])  * e.z,
+            std::fabs(m[1]) * e.x + std::fabs(m[5]) * e.y + std::fabs(m[9])  * e.z,
+            std::fabs(m[2]) * e.x + std::fabs(m[6]) * e.y + std::fabs(m[10]) * e.z
+        );
+
+        AABB result;
+        result.min = c - worldExtents;
+        result.max = c + worldExtents;
+        return result;
+    }
+};
+
+// =============================================================================
+// BOUNDING SPHERE
+// =============================================================================
+struct BoundingSphere {
+    Vec3 center;
+    float radius = -1.0f;   // Negative = empty
+
+    bool isEmpty() const { return radius < 0.0f; }
+
+    // A model matrix may scale unevenly: the largest axis scale keeps the
+    // sphere enclosing
+    BoundingSphere transformed(const Mat4& matrix) const {
+        if (isEmpty()) return {};
+
+        const float* m = matrix.m;
+        float scaleX = Vec3(m[0], m[1], m[2]).lengthSquared();
+        float scaleY = Vec3(m[4], m[5], m[6]).lengthSquared();
+        float scaleZ = Vec3(m[8], m[9], m[10]).lengthSquared();
+        float maxScale = std::sqrt(std::max({scaleX, scaleY, scaleZ}));
+
+        return {matrix.transformPoint(center), radius * maxScale};
+    }
+};
+
+// =============================================================================
+// PLANE: points p with normal.dot(p) + d == 0; positive side = inside
+// =============================================================================
+struct Plane {
+    Vec3 normal;
+    float d = 0.0f;
+
+    float distance(const Vec3& point) const {
+        return normal.dot(point) + d;
+    }
+};
+
+// =============================================================================
+// FRUSTUM
+// =============================================================================
+// The six planes of ANY view-projection matrix's view volume (camera
+// perspective or a shadow cascade's ortho box), extracted straight from
+// the matrix (Gribb-Hartmann):
+//
+// A point is visible when -w <= x, y, z <= w in clip space. Each clip
+// coordinate is one ROW of the matrix dotted with the world point, so e.g.
+//   x >= -w   ⇔   (row3 + row0) · p >= 0
+// which is a plane equation in world space. Same for the other five.
+// =============================================================================
+struct Frustum {
+    enum PlaneIndex { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    std::array<Plane, PlaneCount> planes;
+
+    static Frustum fromMatrix(const Mat4& viewProjection) {
+        const float* m = viewProjection.m;
+        auto row = [m](int r) {
+            return std::array<float, 4>{m[r], m[4 + r], m[8 + r], m[12 + r]};
+        };
+        std::array<float, 4> r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+        auto plane = [](const std::array<float, 4>& a, const std::array<float, 4>& b, float sign) {
+            Plane p;
+            p.normal = Vec3(a[0] + sign * b[0], a[1] + sign * b[1], a[2] + sign * b[2]);
+            p.d = a[3] + sign * b[3];
+
+            // Unit normal: distance() then returns real distances, which
+            // the sphere test needs
+            float length = p.normal.length();
+            if (length > 0.0f) {
+                p.normal = p.normal / length;
+                p.d /= length;
+            }
+            return p;
+        };
+
+        Frustum frustum;
+        frustum.planes[Left]   = plane(r3, r0,  1.0f);
+        frustum.planes[Right]  = plane(r3, r0, -1.0f);
+        frustum.planes[Bottom] = plane(r3, r1,  1.0f);
+        frustum.planes[Top]    = plane(r3, r1, -1.0f);
+        frustum.planes[Near]   = plane(r3, r2,  1.0f);
+        frustum.planes[Far]    = plane(r3, r2, -1.0f);
+        return frustum;
+    }
+
+    // Box test: only the corner furthest along each plane's normal (the
+    // "positive vertex") matters. If even it is behind a plane, the whole
+    // box is.
+    bool intersects(const AABB& box) const {
+        if (box.isEmpty()) return false;
+
+        for (const Plane& plane : planes) {
+            Vec3 positive(plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+                          plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+                          plane.normal.z >= 0.0f ? box.max.z : box.min.z);
+            if (plane.distance(positive) < 0.0f) return false;
+        }
+        return true;
+    }
+
+    bool intersects(const BoundingSphere& sphere) const {
+        if (sphere.isEmpty()) return false;
+
+        for (const Plane& plane : planes) {
+            if (plane.distance(sphere.center) < -sphere.radius) return false;
+        }
+        return true;
+    }
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "Vec3.h"
 #include "Mat4.h"
+#include "Bounds.h"
 #include <cmath>
 
 // =============================================================================
@@ -77,6 +78,12 @@ public:
     Vec3 getTarget() const { return target; }
     Vec3 getUp() const { return up; }
 
+    // Projection parameters (e.g. for fitting shadow cascades to the frustum)
+    float getFOV() const { return fov; }  // Radians
+    float getAspectRatio() const { return aspect; }
+    float getNearPlane() const { return nearPlane; }
+    float getFarPlane() const { return farPlane; }
+
     // Get camera's local axes
     Vec3 getForward() const {
         return (target - position).normalized();
@@ -272,6 +279,15 @@ public:
         return getProjectionMatrix() * getViewMatrix();
     }
 
+    // ==========================================================================
+    // VIEW FRUSTUM
+    // The six world-space planes of what this camera can see, for culling
+    // (derived from view * projection, see Frustum::fromMatrix)
+    // ==========================================================================
+    Frustum getFrustum() {
+        return Frustum::fromMatrix(getViewProjectionMatrix());
+    }
+
     // ==========================================================================
     // SCREEN-SPACE PROJECTION
     // Convert a 3D world point to 2D screen coordinates
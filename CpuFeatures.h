@@ -0,0 +1,80 @@
+#pragma once
+
+// =============================================================================
+// CpuFeatures: Which SIMD instruction sets the RUNNING CPU supports
+// =============================================================================
+// Compiler flags say what the compiler MAY emit; CPUID says what the CPU we
+// are actually running on CAN execute. SIMD paths that go beyond the x86-64
+// baseline (SSE2) are compiled with per-function target attributes and only
+// called after asking here, so one binary runs everywhere.
+//
+// Answers are computed once and cached (CPUID is a serializing instruction,
+// far too slow to call per draw).
+// =============================================================================
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define CPU_FEATURES_X86 1
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #include <immintrin.h>
+        #define CPU_FEATURES_MSVC 1
+        // MSVC allows AVX intrinsics anywhere; no attribute needed
+        #define CPU_TARGET_AVX
+        #define CPU_TARGET_AVX2
+    #else
+        #define CPU_FEATURES_MSVC 0
+        #define CPU_TARGET_AVX  __attribute__((target("avx")))
+        #define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#else
+    #define CPU_FEATURES_X86 0
+#endif
+
+namespace CpuFeatures {
+
+#if CPU_FEATURES_X86 && CPU_FEATURES_MSVC
+// AVX needs CPU support (CPUID.1:ECX bit 28) AND OS support for saving YMM
+// registers on context switch (OSXSAVE + XCR0 bits 1 and 2)
+inline bool osSavesYmm() {
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    return osxsave && (_xgetbv(0) & 0x6) == 0x6;
+}
+#endif
+
+inline bool hasAVX() {
+#if !CPU_FEATURES_X86
+    return false;
+#elif CPU_FEATURES_MSVC
+    static const bool supported = [] {
+        int info[4];
+        __cpuid(info, 1);
+        return osSavesYmm() && (info[2] & (1 << 28)) != 0;
+    }();
+    return supported;
+#else
+    static const bool supported = __builtin_cpu_supports("avx");
+    return supported;
+#endif
+}
+
+inline bool hasAVX2() {
+#if !CPU_FEATURES_X86
+    return false;
+#elif CPU_FEATURES_MSVC
+    // CPUID leaf 7, EBX bit 5
+    static const bool supported = [] {
+        if (!osSavesYmm()) return false;
+        int info[4];
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+    return supported;
+#else
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#endif
+}
+
+} // namespace CpuFeatures
@@ -3,6 +3,8 @@
 #include <vector>
 #include <cstring>
 #include <limits>
+#include <algorithm>
+#include <cstdint>
 
 // =============================================================================
 // Framebuffer: The 2D pixel buffer we render to
@@ -27,13 +29,45 @@
 // WHY ROW-MAJOR?
 // - Cache-friendly: accessing pixels left-to-right is sequential in memory
 // - Matches how display hardware scans (left-to-right, top-to-bottom)
+//
+// OPTIONAL TILED LAYOUT (FramebufferLayout::Tiled):
+// A rasterizer that works in 8x8 blocks touches 8 different rows per block -
+// 8 cache lines for color, 8 for depth, 3.2 KB apart at 800 wide. Tiled
+// storage keeps each 8x8 block CONTIGUOUS instead:
+//   Block (bx, by) = 64 pixels, rows of 8 stored one after another
+//   Blocks ordered row-major across the screen
+//   index = ((y/8) * blocksX + x/8) * 64 + (y%8) * 8 + x%8
+// One block = 256 bytes of color + 256 bytes of depth = a handful of lines
+// that stay hot in L1 while the block is shaded.
+//
+// WHY NOT FULL MORTON (Z-ORDER) INSIDE THE BLOCK?
+// The SIMD row kernels want 8 consecutive pixels of one row to be 8
+// consecutive floats. Row-major within the block keeps that true; Z-order
+// would scatter a row into 2x2 quads.
+//
+// Anything that wants ordinary rows (SDL upload, screenshots) goes through
+// getData()/getDataAsUInt32(), which DETILE into a linear staging copy.
 // =============================================================================
 
+enum class FramebufferLayout {
+    Linear,     // Row-major, index = y * width + x
+    Tiled       // 8x8 blocks, see above
+};
+
 class Framebuffer {
 private:
     int width;
     int height;
-    std::vector<Color> pixels;  // The actual pixel data
+    FramebufferLayout layout;
+    int blockCountX;            // Storage blocks per row (Tiled layout)
+
+    // The actual pixel data (in 'layout' order)
+    // mutable: const readback (getData) may resolve a pending lazy clear
+    mutable std::vector<Color> pixels;
+
+    // Row-major copy of 'pixels' for readback in Tiled layout
+    // (rebuilt on every getData() call; unused in Linear layout)
+    mutable std::vector<Color> linearPixels;
 
     // ==========================================================================
     // Z-BUFFER (DEPTH BUFFER) - ESSENTIAL FOR 3D!
@@ -53,7 +87,57 @@ private:
     // ==========================================================================
     std::vector<float> depthBuffer;
 
+    // ==========================================================================
+    // HIERARCHICAL Z (Hi-Z)
+    // ==========================================================================
+    // One float per 8x8 pixel tile: an UPPER BOUND on the depth of every
+    // pixel in that tile. If a triangle's nearest point over a tile is not
+    // closer than this bound, every pixel would fail the depth test - so the
+    // rasterizer can skip all 64 pixels after one comparison.
+    //
+    // CONSERVATIVE BY DESIGN:
+    // Depth writes only ever make pixels closer, so a stale (too large) bound
+    // is always safe. The rasterizer tightens it when it fully covers a tile;
+    // clearDepth resets it. Single-pixel writes don't need to touch it.
+    //
+    // MEMORY: 1/64 of the depth buffer (7.5 KB at 800x600)
+    // ==========================================================================
+    std::vector<float> hizMaxDepth;
+    int hizTileCountX;
+    int hizTileCountY;
+
+    // ==========================================================================
+    // LAZY CLEAR
+    // ==========================================================================
+    // Clearing 800x600 color + depth with std::fill writes 3.6 MB every frame
+    // (33 MB at 4K) before a single triangle is drawn - and most of those
+    // pixels get overwritten right away.
+    //
+    // Instead, clear() / clearDepth() just remember the clear value and tag
+    // every 8x8 tile (same grid as Hi-Z) as "pending". A pending tile is
+    // filled the first time something writes into it; reads of a pending
+    // tile simply return the clear value. Tiles nobody draws to are filled
+    // at present time (getData), so the total cost is one write per pixel
+    // instead of two.
+    //
+    // COST: one byte per tile, one flag check per pixel access.
+    // ==========================================================================
+    enum : uint8_t {
+        CLEAR_COLOR_PENDING = 1,
+        CLEAR_DEPTH_PENDING = 2
+    };
+    mutable std::vector<uint8_t> tileClearFlags;  // Indexed like hizMaxDepth
+    Color clearColorValue = Color::BLACK;
+    float clearDepthValue = std::numeric_limits<float>::infinity();
+
 public:
+    static constexpr int HIZ_TILE_SIZE = 8;
+    static constexpr int STORAGE_TILE_SIZE = 8;
+
+    // Same size, so a Hi-Z tile is exactly one contiguous storage block
+    static_assert(STORAGE_TILE_SIZE == HIZ_TILE_SIZE,
+                  "storage blocks and Hi-Z tiles must line up");
+
     // ==========================================================================
     // CONSTRUCTOR
     // Allocates memory for width * height pixels
@@ -65,12 +149,29 @@ public:
     // - Still contiguous in memory (cache-friendly)
     //
     // IN PRODUCTION: might use custom allocator for specific alignment
+    //
+    // TILED LAYOUT: storage is padded up to whole 8x8 blocks; the padding
+    // pixels are never addressed
     // ==========================================================================
-    Framebuffer(int width, int height)
-        : width(width), height(height)
-        , pixels(width * height, Color::BLACK)
-        , depthBuffer(width * height, std::numeric_limits<float>::infinity())
+    Framebuffer(int width, int height, FramebufferLayout layout = FramebufferLayout::Linear)
+        : width(width), height(height), layout(layout)
+        , blockCountX((width + STORAGE_TILE_SIZE - 1) / STORAGE_TILE_SIZE)
+        , hizTileCountX((width + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE)
+        , hizTileCountY((height + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE)
     {
+        size_t storageSize = static_cast<size_t>(width) * height;
+        if (layout == FramebufferLayout::Tiled) {
+            int blockCountY = (height + STORAGE_TILE_SIZE - 1) / STORAGE_TILE_SIZE;
+            storageSize = static_cast<size_t>(blockCountX) * blockCountY *
+                          STORAGE_TILE_SIZE * STORAGE_TILE_SIZE;
+        }
+        pixels.assign(storageSize, Color::BLACK);
+        depthBuffer.assign(storageSize, std::numeric_limits<float>::infinity());
+
+        hizMaxDepth.assign(static_cast<size_t>(hizTileCountX) * hizTileCountY,
+                           std::numeric_limits<float>::infinity());
+        tileClearFlags.assign(hizMaxDepth.size(), 0);
+
         // Color buffer: pre-filled with black
         // Depth buffer: pre-filled with infinity (very far away)
         // This ensures first pixel always passes depth test
@@ -78,6 +179,21 @@ public:
 
     int getWidth() const { return width; }
     int getHeight() const { return height; }
+    FramebufferLayout getLayout() const { return layout; }
+
+    // ==========================================================================
+    // STORAGE INDEX
+    // Where pixel (x, y) lives in the color and depth arrays. Every per-pixel
+    // accessor below goes through this, so they work in either layout.
+    // ==========================================================================
+    int storageIndex(int x, int y) const {
+        if (layout == FramebufferLayout::Linear) {
+            return y * width + x;
+        }
+        constexpr int T = STORAGE_TILE_SIZE;
+        int block = (y / T) * blockCountX + (x / T);
+        return block * (T * T) + (y % T) * T + (x % T);
+    }
 
     // ==========================================================================
     // PIXEL ACCESS
@@ -93,26 +209,28 @@ public:
         if (x < 0 || x >= width || y < 0 || y >= height) {
             return;  // Silently ignore out-of-bounds (could also throw)
         }
-        pixels[y * width + x] = color;
+        resolveTileAt(x, y);
+        pixels[storageIndex(x, y)] = color;
     }
 
     Color getPixel(int x, int y) const {
         if (x < 0 || x >= width || y < 0 || y >= height) {
             return Color::BLACK;
         }
-        return pixels[y * width + x];
+        if (tileFlagsAt(x, y) & CLEAR_COLOR_PENDING) return clearColorValue;
+        return pixels[storageIndex(x, y)];
     }
 
     // ==========================================================================
     // CLEAR FRAMEBUFFER
     // Fill entire buffer with a single color
     //
-    // OPTIMIZATION: memset (if color is black) or std::fill
-    // Modern CPUs can clear memory VERY fast (tens of GB/s)
+    // LAZY: only tags the tiles (see LAZY CLEAR above); the actual fill
+    // happens per tile on first write or at present
     // ==========================================================================
     void clear(const Color& color = Color::BLACK) {
-        // std::fill is optimized by compilers, often uses SIMD
-        std::fill(pixels.begin(), pixels.end(), color);
+        clearColorValue = color;
+        for (uint8_t& flags : tileClearFlags) flags |= CLEAR_COLOR_PENDING;
     }
 
     // ==========================================================================
@@ -120,9 +238,10 @@ public:
     // Reset all depths to infinity (very far)
     // MUST be called at start of each 3D frame!
     // ==========================================================================
-    void clearDepth() {
-        std::fill(depthBuffer.begin(), depthBuffer.end(),
-                  std::numeric_limits<float>::infinity());
+    void clearDepth(float depth = std::numeric_limits<float>::infinity()) {
+        clearDepthValue = depth;
+        for (uint8_t& flags : tileClearFlags) flags |= CLEAR_DEPTH_PENDING;
+        std::fill(hizMaxDepth.begin(), hizMaxDepth.end(), depth);
     }
 
     // Clear both color and depth (typical for 3D rendering)
@@ -139,7 +258,8 @@ public:
         if (x < 0 || x >= width || y < 0 || y >= height) {
             return false;  // Out of bounds
         }
-        return depth < depthBuffer[y * width + x];
+        if (tileFlagsAt(x, y) & CLEAR_DEPTH_PENDING) return depth < clearDepthValue;
+        return depth < depthBuffer[storageIndex(x, y)];
     }
 
     // Set pixel WITH depth test
@@ -150,7 +270,8 @@ public:
             return false;
         }
 
-        int index = y * width + x;
+        resolveTileAt(x, y);
+        int index = storageIndex(x, y);
 
         // Depth test: is new pixel closer?
         if (depth < depthBuffer[index]) {
@@ -167,22 +288,61 @@ public:
         if (x < 0 || x >= width || y < 0 || y >= height) {
             return std::numeric_limits<float>::infinity();
         }
-        return depthBuffer[y * width + x];
+        if (tileFlagsAt(x, y) & CLEAR_DEPTH_PENDING) return clearDepthValue;
+        return depthBuffer[storageIndex(x, y)];
     }
 
     // ==========================================================================
     // RAW DATA ACCESS
-    // Returns pointer to the raw pixel array
+    // Returns pointer to the pixels in ROW-MAJOR order (index = y * width + x)
     //
     // WHY NEEDED?
     // - To upload to GPU textures (OpenGL, Vulkan)
     // - To pass to display libraries (SDL)
-    // - For SIMD operations (process 4-8 pixels at once)
+    //
+    // TILED LAYOUT: this is the DETILE step - blocks are copied out row by row
+    // into a staging buffer, and the pointer stays valid until the next call.
+    // Call it once per present, not per pixel.
+    //
+    // Tiles still pending a lazy clear are filled with the clear color here.
     //
     // DANGER: Direct memory access = no bounds checking!
     // ==========================================================================
-    const Color* getData() const { return pixels.data(); }
-    Color* getData() { return pixels.data(); }
+    const Color* getData() const {
+        if (layout == FramebufferLayout::Linear) {
+            for (int ty = 0; ty < hizTileCountY; ty++) {
+                for (int tx = 0; tx < hizTileCountX; tx++) {
+                    uint8_t& flags = tileClearFlags[ty * hizTileCountX + tx];
+                    if (flags & CLEAR_COLOR_PENDING) {
+                        fillTile(pixels, tx, ty, clearColorValue);
+                        flags &= ~CLEAR_COLOR_PENDING;
+                    }
+                }
+            }
+            return pixels.data();
+        }
+        detile();
+        return linearPixels.data();
+    }
+
+    // ==========================================================================
+    // RESOLVE A PENDING CLEAR
+    // Code that writes the raw storage below directly (the rasterizer) must
+    // call this for every tile before touching it. Tiles map 1:1 onto the
+    // Hi-Z grid; tile (tx, ty) covers pixels [tx*8, tx*8+7] x [ty*8, ty*8+7].
+    // ==========================================================================
+    void resolveTile(int tileX, int tileY) {
+        uint8_t& flags = tileClearFlags[tileY * hizTileCountX + tileX];
+        if (flags == 0) return;
+        if (flags & CLEAR_COLOR_PENDING) fillTile(pixels, tileX, tileY, clearColorValue);
+        if (flags & CLEAR_DEPTH_PENDING) fillTile(depthBuffer, tileX, tileY, clearDepthValue);
+        flags = 0;
+    }
+
+    // Pixels in 'layout' order, for code that writes through storageIndex()
+    // (the rasterizer's SIMD kernels). Call resolveTile() first!
+    Color* getColorStorage() { return pixels.data(); }
+    const Color* getColorStorage() const { return pixels.data(); }
 
     // ==========================================================================
     // GET AS UINT32 ARRAY
@@ -193,6 +353,69 @@ public:
     // just telling the compiler "treat this memory as a different type"
     // ==========================================================================
     const uint32_t* getDataAsUInt32() const {
-        return reinterpret_cast<const uint32_t*>(pixels.data());
+        return reinterpret_cast<const uint32_t*>(getData());
+    }
+
+    // Raw depth values, same order as getColorStorage() (see storageIndex)
+    // Used by the SIMD raster kernels for masked depth test + write.
+    // Call resolveTile() first!
+    const float* getDepthStorage() const { return depthBuffer.data(); }
+    float* getDepthStorage() { return depthBuffer.data(); }
+
+    // Hi-Z tile grid: entry (tx, ty) at index ty * getHiZTileCountX() + tx
+    int getHiZTileCountX() const { return hizTileCountX; }
+    int getHiZTileCountY() const { return hizTileCountY; }
+    const float* getHiZData() const { return hizMaxDepth.data(); }
+    float* getHiZData() { return hizMaxDepth.data(); }
+
+private:
+    uint8_t tileFlagsAt(int x, int y) const {
+        return tileClearFlags[(y / HIZ_TILE_SIZE) * hizTileCountX + x / HIZ_TILE_SIZE];
+    }
+
+    void resolveTileAt(int x, int y) {
+        resolveTile(x / HIZ_TILE_SIZE, y / HIZ_TILE_SIZE);
+    }
+
+    // Write 'value' to every on-screen pixel of tile (tileX, tileY)
+    template<typename T>
+    void fillTile(std::vector<T>& buffer, int tileX, int tileY, const T& value) const {
+        constexpr int S = STORAGE_TILE_SIZE;
+        int x0 = tileX * S;
+        int y0 = tileY * S;
+        int x1 = std::min(width, x0 + S);
+        int y1 = std::min(height, y0 + S);
+
+        if (layout == FramebufferLayout::Tiled) {
+            // The whole block is contiguous (padding included)
+            T* block = buffer.data() + storageIndex(x0, y0);
+            std::fill(block, block + S * S, value);
+            return;
+        }
+        for (int y = y0; y < y1; y++) {
+            T* row = buffer.data() + storageIndex(x0, y);
+            std::fill(row, row + (x1 - x0), value);
+        }
+    }
+
+    // Copy each 8x8 block's rows to their row-major position
+    // (pending tiles are written straight from the clear color)
+    void detile() const {
+        constexpr int T = STORAGE_TILE_SIZE;
+        linearPixels.resize(static_cast<size_t>(width) * height);
+
+        for (int y = 0; y < height; y++) {
+            Color* dst = linearPixels.data() + static_cast<size_t>(y) * width;
+            for (int bx = 0; bx < blockCountX; bx++) {
+                int x0 = bx * T;
+                int count = std::min(T, width - x0);
+                if (tileFlagsAt(x0, y) & CLEAR_COLOR_PENDING) {
+                    std::fill(dst + x0, dst + x0 + count, clearColorValue);
+                } else {
+                    std::memcpy(dst + x0, pixels.data() + storageIndex(x0, y),
+                                count * sizeof(Color));
+                }
+            }
+        }
     }
 };
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// =============================================================================
+// IndexCodec: Compact storage for triangle index buffers (mesh files)
+// =============================================================================
+// On disk, a uint32_t per index is mostly zeros. After Mesh::optimize the
+// index buffer is also very PREDICTABLE:
+// - consecutive triangles share vertices (vertex cache order), so an
+//   index is usually close to the one before it
+// - vertices are numbered in first-use order, so a new vertex is always
+//   "one more than the highest so far"
+//
+// ENCODING, per index (in triangle order):
+// 1. DELTA:  d = index - previous index         (small, but can be negative)
+// 2. ZIGZAG: 0, -1, 1, -2, 2 ... → 0, 1, 2, 3, 4 ...  (small unsigned)
+// 3. VARINT: 7 bits per byte, high bit = "more bytes follow"
+//            (0-127 → 1 byte, up to 16383 → 2 bytes, ...)
+//
+//   indices: 0   1   2   2   1   3   ...
+//   deltas:  0  +1  +1   0  -1  +2
+//   zigzag:  0   2   2   0   1   4      → 1 byte each
+//
+// An optimized mesh typically needs ~1 byte per index instead of 4 (or 2
+// for 16-bit indices). Decoding is a single pass with no tables - cheap
+// enough to do on every load.
+// =============================================================================
+
+struct IndexCodec {
+    // ==========================================================================
+    // ENCODE
+    // ==========================================================================
+    static std::vector<uint8_t> encode(std::span<const uint32_t> indices) {
+        std::vector<uint8_t> data;
+        data.reserve(indices.size() + indices.size() / 4);
+
+        uint32_t previous = 0;
+        for (uint32_t index : indices) {
+            // Wraps like the decoder: any uint32_t round-trips
+            int32_t delta = static_cast<int32_t>(index - previous);
+            uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+
+            while (zigzag >= 0x80u) {
+                data.push_back(static_cast<uint8_t>(zigzag | 0x80u));
+                zigzag >>= 7;
+            }
+            data.push_back(static_cast<uint8_t>(zigzag));
+
+            previous = index;
+        }
+        return data;
+    }
+
+    // ==========================================================================
+    // DECODE
+    // Exactly `indexCount` indices from `data`. Returns false (and leaves
+    // `indices` unspecified) if the data is truncated, has bytes left
+    // over, or holds a varint longer than 5 bytes - i.e. it isn't what
+    // encode wrote for that many indices.
+    // Each index is at least one byte, so a count beyond data.size() is
+    // rejected before anything is allocated for it.
+    // ==========================================================================
+    static bool decode(std::span<const uint8_t> data, size_t indexCount,
+                       std::vector<uint32_t>& indices) {
+        if (indexCount > data.size()) return false;
+        indices.resize(indexCount);
+
+        size_t position = 0;
+        uint32_t previous = 0;
+        for (size_t i = 0; i < indexCount; i++) {
+            uint32_t zigzag = 0;
+            for (int shift = 0;; shift += 7) {
+                if (position >= data.size() || shift > 28) return false;
+                uint8_t byte = data[position++];
+                zigzag |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+                if (!(byte & 0x80u)) break;
+            }
+
+            uint32_t delta = (zigzag >> 1) ^ (0u - (zigzag & 1u));
+            previous += delta;
+            indices[i] = previous;
+        }
+        return position == data.size();
+    }
+};
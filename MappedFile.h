@@ -0,0 +1,159 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// =============================================================================
+// MappedFile: A whole file mapped read-only into memory
+// =============================================================================
+// READING vs MAPPING:
+// fread copies the file from the OS page cache into our buffer: the data
+// crosses memory twice, and we wait for ALL of it before touching any.
+//
+// mmap instead makes the file's pages part of our address space. Nothing
+// is read up front; the first access to a page faults it in straight
+// from the page cache. Pointers into the mapping can be handed to
+// anything that reads memory - a parser, memcpy, or glBufferData - with
+// no copy on our side at all.
+//
+// The mapping is READ-ONLY and PRIVATE: writing through it crashes, and
+// the file must not be modified while mapped.
+//
+// Move-only (like the file handle it owns). Failures throw
+// std::runtime_error naming the file.
+// =============================================================================
+
+class MappedFile {
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path) {
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("File mapping failed: cannot open " + path);
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            close();
+            throw std::runtime_error("File mapping failed: cannot get size of " + path);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size == 0) return;   // Nothing to map (an empty mapping is an error)
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (data == nullptr) {
+            close();
+            throw std::runtime_error("File mapping failed: cannot map " + path);
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("File mapping failed: cannot open " + path);
+        }
+
+        struct stat status;
+        if (fstat(fd, &status) != 0) {
+            ::close(fd);
+            throw std::runtime_error("File mapping failed: cannot get size of " + path);
+        }
+        size = static_cast<size_t>(status.st_size);
+        if (size == 0) {
+            ::close(fd);
+            return;
+        }
+
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);   // The mapping keeps its own reference to the file
+        if (mapped == MAP_FAILED) {
+            size = 0;
+            throw std::runtime_error("File mapping failed: cannot map " + path);
+        }
+        data = static_cast<const uint8_t*>(mapped);
+
+        // We'll stream through it front to back: ask for aggressive
+        // read-ahead (hints - failure is harmless). The advice values are
+        // an enumeration, not flags, so each needs its own call.
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        madvise(mapped, size, MADV_WILLNEED);
+#endif
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept {
+        swap(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            swap(other);
+        }
+        return *this;
+    }
+
+    std::span<const uint8_t> bytes() const { return {data, size}; }
+    size_t getSize() const { return size; }
+
+private:
+    void swap(MappedFile& other) noexcept {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+#if defined(_WIN32)
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#endif
+    }
+
+    void close() {
+#if defined(_WIN32)
+        if (data != nullptr) UnmapViewOfFile(data);
+        if (mapping != nullptr) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data != nullptr) munmap(const_cast<uint8_t*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+};
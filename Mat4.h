@@ -1,8 +1,15 @@
 #pragma once
 #include "Vec3.h"
 #include "Vec4.h"
+#include "CpuFeatures.h"
 #include <cmath>
+#include <cstddef>
 #include <cstring>
+#include <type_traits>
+
+#if CPU_FEATURES_X86
+    #include <immintrin.h>
+#endif
 
 // =============================================================================
 // Mat4: 4×4 Matrix for 3D Transformations
@@ -36,8 +43,55 @@
 // - OpenGL standard
 // - Matrix * Vector order: result = M * v
 // - DirectX uses row-major (result = v * M)
+//
+// CONSTEXPR + SIMD:
+// Construction, multiplication, transpose and the inverses are constexpr, so
+// a transform built from constants (Mat4::translate(1, 2, 3) * Mat4::scale(2))
+// can be folded at compile time. At run time, operator*(Mat4) switches to an
+// SSE kernel (std::is_constant_evaluated picks the path). Both paths add
+// the products in the same order of operations; results can still differ
+// in the last bit when the compiler contracts the scalar path into FMAs
+// (e.g. -march=native), so nothing relies on bit equality.
 // =============================================================================
 
+// =============================================================================
+// SoA POINT STREAMS (for Mat4::transformBatch)
+// =============================================================================
+// Structure-of-Arrays: one array per component instead of one struct per
+// point. With x[], y[], z[] separate, a SIMD register loads 4 or 8 x's at
+// once and the SAME matrix math runs on every lane - no shuffles needed.
+//
+//   AoS: [x0 y0 z0][x1 y1 z1][x2 y2 z2]...      (Vertex::position)
+//   SoA: [x0 x1 x2 ...] [y0 y1 y2 ...] [z0 z1 z2 ...]
+// =============================================================================
+struct SoAPoints {
+    const float* x;
+    const float* y;
+    const float* z;     // w is implicitly 1 (points, not directions)
+};
+
+struct SoAClipOut {
+    float* x;
+    float* y;
+    float* z;
+    float* w;
+};
+
+// Optional fused perspective divide + viewport mapping:
+//   invW  = 1 / w
+//   x     = (x * invW + 1) * width / 2
+//   y     = (1 - y * invW) * height / 2      (Y flipped: screen +Y is down)
+//   depth = z * invW                          (NDC z)
+// Only meaningful for points with w > 0; callers clip the rest anyway.
+struct SoAScreenOut {
+    float* x;
+    float* y;
+    float* depth;
+    float* invW;
+    float width;
+    float height;
+};
+
 struct Mat4 {
     // Column-major storage (OpenGL convention)
     float m[16];
@@ -45,22 +99,22 @@ struct Mat4 {
     // ==========================================================================
     // CONSTRUCTORS
     // ==========================================================================
-    Mat4() {
-        // Initialize to identity by default
-        std::memset(m, 0, sizeof(m));
-        m[0] = m[5] = m[10] = m[15] = 1.0f;
-    }
+    // Initialize to identity by default
+    constexpr Mat4()
+        : m{1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f} {}
 
     // Construct from 16 floats (column-major order)
-    Mat4(float m0,  float m1,  float m2,  float m3,
-         float m4,  float m5,  float m6,  float m7,
-         float m8,  float m9,  float m10, float m11,
-         float m12, float m13, float m14, float m15) {
-        m[0]  = m0;  m[1]  = m1;  m[2]  = m2;  m[3]  = m3;
-        m[4]  = m4;  m[5]  = m5;  m[6]  = m6;  m[7]  = m7;
-        m[8]  = m8;  m[9]  = m9;  m[10] = m10; m[11] = m11;
-        m[12] = m12; m[13] = m13; m[14] = m14; m[15] = m15;
-    }
+    constexpr Mat4(float m0,  float m1,  float m2,  float m3,
+                   float m4,  float m5,  float m6,  float m7,
+                   float m8,  float m9,  float m10, float m11,
+                   float m12, float m13, float m14, float m15)
+        : m{m0,  m1,  m2,  m3,
+            m4,  m5,  m6,  m7,
+            m8,  m9,  m10, m11,
+            m12, m13, m14, m15} {}
 
     // ==========================================================================
     // MATRIX MULTIPLICATION
@@ -73,8 +127,19 @@ struct Mat4 {
     //
     // PERFORMANCE: 64 multiplies + 48 adds per matrix multiply
     // GPUs have dedicated hardware for this!
+    //
+    // SIMD (COLUMN BROADCAST):
+    // Column j of the result is a linear combination of OUR columns:
+    //   result.col(j) = col(0)*other[j][0] + col(1)*other[j][1] + ...
+    // Load each of our columns into one SSE register, broadcast one scalar of
+    // 'other', multiply-add: 16 vector multiplies instead of 64 scalar ones.
     // ==========================================================================
-    Mat4 operator*(const Mat4& other) const {
+    constexpr Mat4 operator*(const Mat4& other) const {
+#if CPU_FEATURES_X86
+        if (!std::is_constant_evaluated()) {
+            return multiplySSE(other);
+        }
+#endif
         Mat4 result;
 
         // For each column of result (j)
@@ -100,7 +165,7 @@ struct Mat4 {
     // This is how we transform vertices
     // Each vertex is multiplied by model, view, projection matrices
     // ==========================================================================
-    Vec4 operator*(const Vec4& v) const {
+    constexpr Vec4 operator*(const Vec4& v) const {
         return Vec4(
             m[0]*v.x + m[4]*v.y + m[8]*v.z  + m[12]*v.w,  // Row 0 · v
             m[1]*v.x + m[5]*v.y + m[9]*v.z  + m[13]*v.w,  // Row 1 · v
@@ -109,6 +174,75 @@ struct Mat4 {
         );
     }
 
+    // ==========================================================================
+    // BATCH TRANSFORM (SoA)
+    // clip[i] = M * (x[i], y[i], z[i], 1) for i in [0, count)
+    // If screen is non-null, also writes the divided, viewport-mapped point.
+    //
+    // Picks the widest kernel the running CPU supports (AVX: 8 points per
+    // iteration, SSE2: 4, scalar otherwise). Every kernel performs the same
+    // operations in the same order - including a real division, not the
+    // approximate reciprocal instruction - so results match the scalar path
+    // and operator*(Vec4) up to FMA contraction (last-bit differences).
+    //
+    // Inputs and outputs need no special alignment. Outputs must not alias
+    // inputs.
+    // ==========================================================================
+    void transformBatch(const SoAPoints& in, size_t count,
+                        const SoAClipOut& clip, const SoAScreenOut* screen = nullptr) const;
+
+private:
+    // Inverse of the upper-left 3x3 into out (rest of out = identity).
+    // Returns false if it is singular.
+    constexpr bool invert3x3(Mat4& out) const {
+        auto at = [this](int r, int c) { return m[c * 4 + r]; };
+
+        // Cofactors of the first row...
+        float c00 = at(1, 1) * at(2, 2) - at(1, 2) * at(2, 1);
+        float c01 = at(1, 2) * at(2, 0) - at(1, 0) * at(2, 2);
+        float c02 = at(1, 0) * at(2, 1) - at(1, 1) * at(2, 0);
+
+        float det = at(0, 0) * c00 + at(0, 1) * c01 + at(0, 2) * c02;
+        if (det == 0.0f) return false;
+        float invDet = 1.0f / det;
+
+        // inverse[r][c] = cofactor[c][r] / det
+        out = Mat4();
+        out.m[0] = c00 * invDet;
+        out.m[1] = c01 * invDet;
+        out.m[2] = c02 * invDet;
+        out.m[4] = (at(0, 2) * at(2, 1) - at(0, 1) * at(2, 2)) * invDet;
+        out.m[5] = (at(0, 0) * at(2, 2) - at(0, 2) * at(2, 0)) * invDet;
+        out.m[6] = (at(0, 1) * at(2, 0) - at(0, 0) * at(2, 1)) * invDet;
+        out.m[8] = (at(0, 1) * at(1, 2) - at(0, 2) * at(1, 1)) * invDet;
+        out.m[9] = (at(0, 2) * at(1, 0) - at(0, 0) * at(1, 2)) * invDet;
+        out.m[10] = (at(0, 0) * at(1, 1) - at(0, 1) * at(1, 0)) * invDet;
+        return true;
+    }
+
+#if CPU_FEATURES_X86
+    Mat4 multiplySSE(const Mat4& other) const {
+        const __m128 col0 = _mm_loadu_ps(m + 0);
+        const __m128 col1 = _mm_loadu_ps(m + 4);
+        const __m128 col2 = _mm_loadu_ps(m + 8);
+        const __m128 col3 = _mm_loadu_ps(m + 12);
+
+        Mat4 result;
+        for (int j = 0; j < 4; j++) {
+            const float* b = other.m + j * 4;
+            // Same summation order as the scalar loop: ((b0 + b1) + b2) + b3
+            __m128 sum = _mm_mul_ps(col0, _mm_set1_ps(b[0]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(col1, _mm_set1_ps(b[1])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(col2, _mm_set1_ps(b[2])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(col3, _mm_set1_ps(b[3])));
+            _mm_storeu_ps(result.m + j * 4, sum);
+        }
+        return result;
+    }
+#endif
+
+public:
+
     // Transform Vec3 as point (w=1, affected by translation)
     Vec3 transformPoint(const Vec3& v) const {
         Vec4 result = (*this) * Vec4(v, 1.0f);
@@ -121,6 +255,133 @@ struct Mat4 {
         return result.xyz();  // No perspective divide for directions
     }
 
+    // ==========================================================================
+    // TRANSPOSE
+    // Swap rows and columns: result[i][j] = this[j][i]
+    // ==========================================================================
+    constexpr Mat4 transposed() const {
+        Mat4 result;
+        for (int j = 0; j < 4; j++) {
+            for (int i = 0; i < 4; i++) {
+                result.m[j * 4 + i] = m[i * 4 + j];
+            }
+        }
+        return result;
+    }
+
+    // ==========================================================================
+    // GENERAL INVERSE
+    // M^-1 = adjugate(M) / det(M), via 2x2 sub-determinants:
+    // every 3x3 cofactor is built from six 2x2 minors of the top two rows
+    // and six of the bottom two, so the whole thing is ~100 multiplies
+    // instead of the ~300 of naive cofactor expansion.
+    //
+    // Use for projections and anything with a non-trivial bottom row.
+    // Singular matrices (det == 0) return identity.
+    // ==========================================================================
+    constexpr Mat4 inverse() const {
+        // Element at row r, column c
+        auto at = [this](int r, int c) { return m[c * 4 + r]; };
+
+        // 2x2 minors of rows 0-1 (s) and rows 2-3 (c), over column pairs
+        float s0 = at(0, 0) * at(1, 1) - at(1, 0) * at(0, 1);
+        float s1 = at(0, 0) * at(1, 2) - at(1, 0) * at(0, 2);
+        float s2 = at(0, 0) * at(1, 3) - at(1, 0) * at(0, 3);
+        float s3 = at(0, 1) * at(1, 2) - at(1, 1) * at(0, 2);
+        float s4 = at(0, 1) * at(1, 3) - at(1, 1) * at(0, 3);
+        float s5 = at(0, 2) * at(1, 3) - at(1, 2) * at(0, 3);
+
+        float c5 = at(2, 2) * at(3, 3) - at(3, 2) * at(2, 3);
+        float c4 = at(2, 1) * at(3, 3) - at(3, 1) * at(2, 3);
+        float c3 = at(2, 1) * at(3, 2) - at(3, 1) * at(2, 2);
+        float c2 = at(2, 0) * at(3, 3) - at(3, 0) * at(2, 3);
+        float c1 = at(2, 0) * at(3, 2) - at(3, 0) * at(2, 2);
+        float c0 = at(2, 0) * at(3, 1) - at(3, 0) * at(2, 1);
+
+        float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        if (det == 0.0f) return Mat4();
+        float invDet = 1.0f / det;
+
+        // Row-major adjugate entries, scaled
+        float r[16] = {
+            ( at(1, 1) * c5 - at(1, 2) * c4 + at(1, 3) * c3) * invDet,
+            (-at(0, 1) * c5 + at(0, 2) * c4 - at(0, 3) * c3) * invDet,
+            ( at(3, 1) * s5 - at(3, 2) * s4 + at(3, 3) * s3) * invDet,
+            (-at(2, 1) * s5 + at(2, 2) * s4 - at(2, 3) * s3) * invDet,
+
+            (-at(1, 0) * c5 + at(1, 2) * c2 - at(1, 3) * c1) * invDet,
+            ( at(0, 0) * c5 - at(0, 2) * c2 + at(0, 3) * c1) * invDet,
+            (-at(3, 0) * s5 + at(3, 2) * s2 - at(3, 3) * s1) * invDet,
+            ( at(2, 0) * s5 - at(2, 2) * s2 + at(2, 3) * s1) * invDet,
+
+            ( at(1, 0) * c4 - at(1, 1) * c2 + at(1, 3) * c0) * invDet,
+            (-at(0, 0) * c4 + at(0, 1) * c2 - at(0, 3) * c0) * invDet,
+            ( at(3, 0) * s4 - at(3, 1) * s2 + at(3, 3) * s0) * invDet,
+            (-at(2, 0) * s4 + at(2, 1) * s2 - at(2, 3) * s0) * invDet,
+
+            (-at(1, 0) * c3 + at(1, 1) * c1 - at(1, 2) * c0) * invDet,
+            ( at(0, 0) * c3 - at(0, 1) * c1 + at(0, 2) * c0) * invDet,
+            (-at(3, 0) * s3 + at(3, 1) * s1 - at(3, 2) * s0) * invDet,
+            ( at(2, 0) * s3 - at(2, 1) * s1 + at(2, 2) * s0) * invDet,
+        };
+
+        // r is row-major; transpose into our column-major storage
+        Mat4 result;
+        for (int row = 0; row < 4; row++) {
+            for (int col = 0; col < 4; col++) {
+                result.m[col * 4 + row] = r[row * 4 + col];
+            }
+        }
+        return result;
+    }
+
+    // ==========================================================================
+    // AFFINE INVERSE
+    // For M = [A t; 0 1] (any model/view matrix: rotation, scale, shear,
+    // translation - but NOT a projection):
+    //   M^-1 = [A^-1  -A^-1 t; 0 1]
+    // Only a 3x3 inverse is needed: roughly a third of the general inverse.
+    // Singular A returns identity.
+    // ==========================================================================
+    constexpr Mat4 inverseAffine() const {
+        Mat4 result;
+        if (!invert3x3(result)) return Mat4();
+
+        // -A^-1 * t
+        for (int i = 0; i < 3; i++) {
+            result.m[12 + i] = -(result.m[i] * m[12] + result.m[4 + i] * m[13] +
+                                 result.m[8 + i] * m[14]);
+        }
+        return result;
+    }
+
+    // ==========================================================================
+    // NORMAL MATRIX
+    // Normals must be transformed by the INVERSE-TRANSPOSE of the upper 3x3,
+    // not by the model matrix itself. With non-uniform scale (a floor slab
+    // scaled (6, 0.2, 6)) the model matrix squashes normals toward the wrong
+    // direction; the inverse-transpose keeps them perpendicular to the
+    // surface. For pure rotations it equals the rotation.
+    //
+    // Returned as a Mat4 with zero translation so transformDirection works;
+    // the GPU path uploads its 3x3 part (see toMat3).
+    // Renormalize after transforming (scale changes lengths).
+    // ==========================================================================
+    constexpr Mat4 normalMatrix() const {
+        Mat4 inverse3;
+        if (!invert3x3(inverse3)) return Mat4();
+        return inverse3.transposed();
+    }
+
+    // Upper-left 3x3, column-major (for glUniformMatrix3fv)
+    constexpr void toMat3(float out[9]) const {
+        for (int col = 0; col < 3; col++) {
+            for (int row = 0; row < 3; row++) {
+                out[col * 3 + row] = m[col * 4 + row];
+            }
+        }
+    }
+
     // ==========================================================================
     // IDENTITY MATRIX
     // [1 0 0 0]
@@ -128,7 +389,7 @@ struct Mat4 {
     // [0 0 1 0]
     // [0 0 0 1]
     // ==========================================================================
-    static Mat4 identity() {
+    static constexpr Mat4 identity() {
         return Mat4();  // Constructor already makes identity
     }
 
@@ -141,7 +402,7 @@ struct Mat4 {
     //
     // Effect: (x, y, z) → (x+tx, y+ty, z+tz)
     // ==========================================================================
-    static Mat4 translate(const Vec3& t) {
+    static constexpr Mat4 translate(const Vec3& t) {
         Mat4 result;
         result.m[12] = t.x;
         result.m[13] = t.y;
@@ -149,7 +410,7 @@ struct Mat4 {
         return result;
     }
 
-    static Mat4 translate(float x, float y, float z) {
+    static constexpr Mat4 translate(float x, float y, float z) {
         return translate(Vec3(x, y, z));
     }
 
@@ -162,7 +423,7 @@ struct Mat4 {
     //
     // Effect: (x, y, z) → (x*sx, y*sy, z*sz)
     // ==========================================================================
-    static Mat4 scale(const Vec3& s) {
+    static constexpr Mat4 scale(const Vec3& s) {
         Mat4 result;
         result.m[0]  = s.x;
         result.m[5]  = s.y;
@@ -170,11 +431,11 @@ struct Mat4 {
         return result;
     }
 
-    static Mat4 scale(float x, float y, float z) {
+    static constexpr Mat4 scale(float x, float y, float z) {
         return scale(Vec3(x, y, z));
     }
 
-    static Mat4 scale(float s) {
+    static constexpr Mat4 scale(float s) {
         return scale(s, s, s);  // Uniform scale
     }
 
@@ -347,3 +608,137 @@ struct Mat4 {
         return result;
     }
 };
+
+// =============================================================================
+// BATCH TRANSFORM KERNELS
+// =============================================================================
+// Each matrix entry is broadcast into its own register ONCE; the loop body
+// is then 12 multiply-adds for 4 or 8 points:
+//   cx = m0*x + m4*y + m8*z  + m12      (and likewise cy, cz, cw)
+// =============================================================================
+namespace Mat4Batch {
+
+inline void transformScalar(const Mat4& mat, const SoAPoints& in, size_t begin, size_t end,
+                            const SoAClipOut& clip, const SoAScreenOut* screen) {
+    const float* m = mat.m;
+    for (size_t i = begin; i < end; i++) {
+        float x = in.x[i], y = in.y[i], z = in.z[i];
+        float cx = m[0]*x + m[4]*y + m[8]*z  + m[12];
+        float cy = m[1]*x + m[5]*y + m[9]*z  + m[13];
+        float cz = m[2]*x + m[6]*y + m[10]*z + m[14];
+        float cw = m[3]*x + m[7]*y + m[11]*z + m[15];
+        clip.x[i] = cx;
+        clip.y[i] = cy;
+        clip.z[i] = cz;
+        clip.w[i] = cw;
+
+        if (screen) {
+            float invW = 1.0f / cw;
+            screen->x[i] = (cx * invW + 1.0f) * (0.5f * screen->width);
+            screen->y[i] = (1.0f - cy * invW) * (0.5f * screen->height);
+            screen->depth[i] = cz * invW;
+            screen->invW[i] = invW;
+        }
+    }
+}
+
+#if CPU_FEATURES_X86
+
+// Returns the index of the first point NOT processed (the scalar tail)
+inline size_t transformSSE2(const Mat4& mat, const SoAPoints& in, size_t count,
+                            const SoAClipOut& clip, const SoAScreenOut* screen) {
+    __m128 m[16];
+    for (int k = 0; k < 16; k++) m[k] = _mm_set1_ps(mat.m[k]);
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 halfWidth = _mm_set1_ps(screen ? 0.5f * screen->width : 0.0f);
+    const __m128 halfHeight = _mm_set1_ps(screen ? 0.5f * screen->height : 0.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(in.x + i);
+        __m128 y = _mm_loadu_ps(in.y + i);
+        __m128 z = _mm_loadu_ps(in.z + i);
+
+        __m128 c[4];
+        for (int r = 0; r < 4; r++) {
+            c[r] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[r], x),
+                                                    _mm_mul_ps(m[4 + r], y)),
+                                         _mm_mul_ps(m[8 + r], z)),
+                              m[12 + r]);
+        }
+        _mm_storeu_ps(clip.x + i, c[0]);
+        _mm_storeu_ps(clip.y + i, c[1]);
+        _mm_storeu_ps(clip.z + i, c[2]);
+        _mm_storeu_ps(clip.w + i, c[3]);
+
+        if (screen) {
+            __m128 invW = _mm_div_ps(one, c[3]);
+            _mm_storeu_ps(screen->x + i,
+                          _mm_mul_ps(_mm_add_ps(_mm_mul_ps(c[0], invW), one), halfWidth));
+            _mm_storeu_ps(screen->y + i,
+                          _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(c[1], invW)), halfHeight));
+            _mm_storeu_ps(screen->depth + i, _mm_mul_ps(c[2], invW));
+            _mm_storeu_ps(screen->invW + i, invW);
+        }
+    }
+    return i;
+}
+
+CPU_TARGET_AVX
+inline size_t transformAVX(const Mat4& mat, const SoAPoints& in, size_t count,
+                           const SoAClipOut& clip, const SoAScreenOut* screen) {
+    __m256 m[16];
+    for (int k = 0; k < 16; k++) m[k] = _mm256_set1_ps(mat.m[k]);
+
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 halfWidth = _mm256_set1_ps(screen ? 0.5f * screen->width : 0.0f);
+    const __m256 halfHeight = _mm256_set1_ps(screen ? 0.5f * screen->height : 0.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(in.x + i);
+        __m256 y = _mm256_loadu_ps(in.y + i);
+        __m256 z = _mm256_loadu_ps(in.z + i);
+
+        __m256 c[4];
+        for (int r = 0; r < 4; r++) {
+            c[r] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[r], x),
+                                                             _mm256_mul_ps(m[4 + r], y)),
+                                               _mm256_mul_ps(m[8 + r], z)),
+                                 m[12 + r]);
+        }
+        _mm256_storeu_ps(clip.x + i, c[0]);
+        _mm256_storeu_ps(clip.y + i, c[1]);
+        _mm256_storeu_ps(clip.z + i, c[2]);
+        _mm256_storeu_ps(clip.w + i, c[3]);
+
+        if (screen) {
+            __m256 invW = _mm256_div_ps(one, c[3]);
+            _mm256_storeu_ps(screen->x + i,
+                             _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(c[0], invW), one), halfWidth));
+            _mm256_storeu_ps(screen->y + i,
+                             _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(c[1], invW)), halfHeight));
+            _mm256_storeu_ps(screen->depth + i, _mm256_mul_ps(c[2], invW));
+            _mm256_storeu_ps(screen->invW + i, invW);
+        }
+    }
+    return i;
+}
+
+#endif  // CPU_FEATURES_X86
+
+} // namespace Mat4Batch
+
+inline void Mat4::transformBatch(const SoAPoints& in, size_t count,
+                                 const SoAClipOut& clip, const SoAScreenOut* screen) const {
+    size_t done = 0;
+#if CPU_FEATURES_X86
+    if (CpuFeatures::hasAVX()) {
+        done = Mat4Batch::transformAVX(*this, in, count, clip, screen);
+    } else {
+        done = Mat4Batch::transformSSE2(*this, in, count, clip, screen);
+    }
+#endif
+    Mat4Batch::transformScalar(*this, in, done, count, clip, screen);
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include "Vec3.h"
 #include "Color.h"
+#include "Bounds.h"
+#include "MeshOptimizer.h"
 #include <vector>
 
 // =============================================================================
@@ -51,6 +53,12 @@ public:
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;  // Triplets: each 3 indices = 1 triangle
 
+    // Object-space bounding volumes (for frustum culling, see Bounds.h).
+    // The generators fill them in; call computeBounds after editing
+    // vertices by hand. Empty bounds = unknown, never culled.
+    AABB bounds;
+    BoundingSphere boundingSphere;
+
     Mesh() = default;
 
     // ==========================================================================
@@ -68,6 +76,72 @@ public:
         v2 = vertices[indices[idx + 2]];
     }
 
+    // ==========================================================================
+    // COMPUTE BOUNDS
+    // Box: min/max over all positions. Sphere: centered on the box (not
+    // the tightest possible sphere, but one pass and always enclosing).
+    // ==========================================================================
+    void computeBounds() {
+        bounds = AABB();
+        for (const Vertex& vertex : vertices) {
+            bounds.expand(vertex.position);
+        }
+
+        boundingSphere = BoundingSphere();
+        if (bounds.isEmpty()) return;
+
+        boundingSphere.center = bounds.center();
+        float radiusSquared = 0.0f;
+        for (const Vertex& vertex : vertices) {
+            radiusSquared = std::max(radiusSquared,
+                                     (vertex.position - boundingSphere.center).lengthSquared());
+        }
+        boundingSphere.radius = std::sqrt(radiusSquared);
+    }
+
+    // ==========================================================================
+    // OPTIMIZE (see MeshOptimizer.h)
+    // Reorder for the GPU without changing what's drawn:
+    // 1. Triangles for the post-transform vertex cache
+    // 2. Clusters of those triangles, outward-facing first (less overdraw)
+    // 3. Vertices in first-use order (sequential fetch); vertices no
+    //    triangle uses are dropped
+    // Returns the cache statistics before and after (to show the gain).
+    // Call once, after the mesh is complete and before uploading it.
+    // ==========================================================================
+    struct OptimizeReport {
+        MeshOptimizer::CacheStats before;
+        MeshOptimizer::CacheStats after;
+    };
+
+    OptimizeReport optimize(float overdrawThreshold = 1.05f) {
+        OptimizeReport report;
+        report.before = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+        MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+
+        std::vector<Vec3> positions(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            positions[i] = vertices[i].position;
+        }
+        MeshOptimizer::optimizeOverdraw(indices, positions, overdrawThreshold);
+
+        size_t usedVertices = 0;
+        std::vector<uint32_t> remap =
+            MeshOptimizer::optimizeVertexFetchRemap(indices, vertices.size(), usedVertices);
+        std::vector<Vertex> remapped(usedVertices);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (remap[i] != MeshOptimizer::INVALID_REMAP) {
+                remapped[remap[i]] = vertices[i];
+            }
+        }
+        vertices.swap(remapped);
+        if (!bounds.isEmpty()) computeBounds();   // Dropped vertices may have been outliers
+
+        report.after = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+        return report;
+    }
+
     // Duplicate geometry with flipped normals so both sides render with correct lighting
     void makeDoubleSided() {
         size_t originalVertexCount = vertices.size();
@@ -184,6 +258,7 @@ public:
             mesh.indices.push_back(base + 3);
         }
 
+        mesh.computeBounds();
         return mesh;
     }
 
@@ -235,6 +310,7 @@ public:
             mesh.indices.push_back(base_idx + 2);
         }
 
+        mesh.computeBounds();
         return mesh;
     }
 
@@ -286,6 +362,7 @@ public:
             }
         }
 
+        mesh.computeBounds();
         return mesh;
     }
 };
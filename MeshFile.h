@@ -0,0 +1,440 @@
+#pragma once
+#include "Mesh.h"
+#include "Bounds.h"
+#include "IndexCodec.h"
+#include "MappedFile.h"
+#include "Mat4.h"
+#include "PackedVertex.h"
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// =============================================================================
+// MeshFile: Binary mesh container, loaded by mapping instead of parsing
+// =============================================================================
+// A text format (OBJ, PLY ascii) has to be TOKENIZED and CONVERTED on every
+// load: millions of strtof calls before the first byte reaches the GPU.
+// This format stores the buffers exactly as the GPU wants them, so
+// "loading" is: map the file, check the header, hand the GPU pointers
+// into the mapping (RendererGL::uploadMesh(const MeshView&)).
+//
+// LAYOUT (little-endian, every stream starts on a 16-byte boundary):
+//
+//   ┌────────────────────┐ 0
+//   │ MeshFileHeader     │ magic "RMSH", version, formats, counts, AABB,
+//   │                    │ quantization box, stream offsets/sizes
+//   ├────────────────────┤ vertexOffset
+//   │ vertex stream      │ Vertex[vertexCount] (28 B) or PackedVertex (16 B)
+//   ├────────────────────┤ indexOffset
+//   │ index stream       │ every LOD's indices, one range per LOD:
+//   │                    │ uint16 / uint32 as-is, or IndexCodec bytes
+//   ├────────────────────┤ lodOffset
+//   │ MeshFileLod[]      │ LOD 0 = full detail, then coarser levels
+//   └────────────────────┘
+//
+// All LODs share the vertex stream (a coarse LOD just uses fewer of the
+// vertices), so switching LOD is a different index range - no new
+// vertex buffer.
+//
+// ZERO-COPY vs COMPRESSED INDICES:
+// Raw indices (16-bit whenever the mesh has ≤ 65536 vertices, like the
+// renderer picks) upload straight from the mapping. IndexCodec indices
+// are ~3x smaller on disk but must be decoded into memory first - a
+// size/load-time trade-off chosen when writing the file.
+//
+// VALIDATION:
+// MeshView checks the header and that every range lies inside the file
+// (so no pointer it hands out reads past the mapping). It does NOT scan
+// the index values - that would be parsing. toMesh, which copies into a
+// Mesh the CPU will index with, does check them.
+//
+// VERSIONING:
+// Readers accept exactly VERSION. Any layout change bumps it; old files
+// are rejected with a clear error rather than misread.
+// =============================================================================
+
+static_assert(std::endian::native == std::endian::little,
+              "MeshFile stores little-endian data and reads it in place");
+static_assert(sizeof(Vertex) == 28 && std::is_trivially_copyable_v<Vertex>,
+              "Float vertex streams are Vertex arrays byte for byte");
+
+struct MeshFileHeader {
+    char magic[4];              // "RMSH"
+    uint32_t version;
+    uint32_t vertexFormat;      // VertexFormat
+    uint32_t indexStorage;      // MeshFile::IndexStorage
+    uint64_t vertexCount;
+    uint64_t vertexOffset;      // File offsets and sizes in bytes
+    uint64_t vertexBytes;
+    uint64_t indexOffset;
+    uint64_t indexBytes;
+    uint64_t lodOffset;
+    uint32_t lodCount;
+    uint32_t reserved;          // 0
+    float boundsMin[3];         // Object-space AABB (empty if the mesh had none)
+    float boundsMax[3];
+    float quantizationMin[3];   // Packed: the box positions are relative to
+    float quantizationMax[3];
+};
+static_assert(sizeof(MeshFileHeader) == 120, "MeshFileHeader layout is part of the format");
+
+struct MeshFileLod {
+    uint64_t indexOffset;       // Bytes from the start of the index stream
+    uint64_t indexBytes;
+    uint64_t indexCount;
+    float error;                // Object-space deviation from LOD 0 (0 for LOD 0)
+    uint32_t reserved;          // 0
+};
+static_assert(sizeof(MeshFileLod) == 32, "MeshFileLod layout is part of the format");
+
+struct MeshFile {
+    static constexpr char MAGIC[4] = {'R', 'M', 'S', 'H'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ALIGNMENT = 16;
+
+    enum class IndexStorage : uint32_t {
+        Uint16,       // Raw uint16_t (meshes with ≤ 65536 vertices)
+        Uint32,       // Raw uint32_t
+        Compressed    // IndexCodec bytes, decoded on load
+    };
+
+    // A coarser level of detail: indices into the same vertices
+    struct LodIndices {
+        std::span<const uint32_t> indices;
+        float error;
+    };
+
+    struct WriteOptions {
+        VertexFormat vertexFormat = VertexFormat::Float;
+        bool compressIndices = false;
+        std::vector<LodIndices> lods;   // LOD 1, 2, ... (LOD 0 is mesh.indices)
+    };
+
+    // ==========================================================================
+    // WRITE
+    // Throws std::runtime_error if the file can't be written or an index
+    // is out of range.
+    // ==========================================================================
+    static void write(const std::string& path, const Mesh& mesh) {
+        write(path, mesh, WriteOptions());
+    }
+
+    static void write(const std::string& path, const Mesh& mesh, const WriteOptions& options) {
+        MeshFileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.vertexFormat = static_cast<uint32_t>(options.vertexFormat);
+        header.vertexCount = mesh.vertices.size();
+        storeVec3(header.boundsMin, mesh.bounds.min);
+        storeVec3(header.boundsMax, mesh.bounds.max);
+
+        // ======================================================================
+        // VERTEX STREAM
+        // ======================================================================
+        std::vector<PackedVertex> packed;
+        const void* vertexData = mesh.vertices.data();
+        header.vertexBytes = mesh.vertices.size() * sizeof(Vertex);
+        if (options.vertexFormat == VertexFormat::Packed) {
+            AABB box = VertexPacking::quantizationBounds(mesh.vertices);
+            packed = VertexPacking::pack(mesh.vertices, box);
+            vertexData = packed.data();
+            header.vertexBytes = packed.size() * sizeof(PackedVertex);
+            storeVec3(header.quantizationMin, box.min);
+            storeVec3(header.quantizationMax, box.max);
+        }
+
+        // ======================================================================
+        // INDEX STREAM (one range per LOD, each 16-byte aligned)
+        // ======================================================================
+        IndexStorage storage = options.compressIndices ? IndexStorage::Compressed
+                             : mesh.vertices.size() <= 65536 ? IndexStorage::Uint16
+                             : IndexStorage::Uint32;
+        header.indexStorage = static_cast<uint32_t>(storage);
+
+        std::vector<LodIndices> levels;
+        levels.push_back({mesh.indices, 0.0f});
+        levels.insert(levels.end(), options.lods.begin(), options.lods.end());
+
+        std::vector<uint8_t> indexStream;
+        std::vector<MeshFileLod> lodTable;
+        for (const LodIndices& level : levels) {
+            for (uint32_t index : level.indices) {
+                if (index >= mesh.vertices.size()) {
+                    throw std::runtime_error("Mesh file write failed: index out of range (" + path + ")");
+                }
+            }
+
+            indexStream.resize(alignUp(indexStream.size()));
+            MeshFileLod lod{};
+            lod.indexOffset = indexStream.size();
+            lod.indexCount = level.indices.size();
+            lod.error = level.error;
+
+            if (storage == IndexStorage::Compressed) {
+                std::vector<uint8_t> encoded = IndexCodec::encode(level.indices);
+                indexStream.insert(indexStream.end(), encoded.begin(), encoded.end());
+            } else if (storage == IndexStorage::Uint16) {
+                for (uint32_t index : level.indices) {
+                    uint16_t value = static_cast<uint16_t>(index);
+                    appendBytes(indexStream, &value, sizeof(value));
+                }
+            } else {
+                appendBytes(indexStream, level.indices.data(), level.indices.size_bytes());
+            }
+            lod.indexBytes = indexStream.size() - lod.indexOffset;
+            lodTable.push_back(lod);
+        }
+
+        header.vertexOffset = alignUp(sizeof(MeshFileHeader));
+        header.indexOffset = alignUp(header.vertexOffset + header.vertexBytes);
+        header.indexBytes = indexStream.size();
+        header.lodOffset = alignUp(header.indexOffset + header.indexBytes);
+        header.lodCount = static_cast<uint32_t>(lodTable.size());
+
+        // ======================================================================
+        // OUTPUT
+        // ======================================================================
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Mesh file write failed: cannot create " + path);
+        }
+
+        uint64_t written = 0;
+        auto put = [&](uint64_t offset, const void* data, size_t size) {
+            static constexpr char zeros[ALIGNMENT] = {};
+            file.write(zeros, static_cast<std::streamsize>(offset - written));   // Padding
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written = offset + size;
+        };
+        put(0, &header, sizeof(header));
+        put(header.vertexOffset, vertexData, header.vertexBytes);
+        put(header.indexOffset, indexStream.data(), indexStream.size());
+        put(header.lodOffset, lodTable.data(), lodTable.size() * sizeof(MeshFileLod));
+
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Mesh file write failed: error writing " + path);
+        }
+    }
+
+    // ==========================================================================
+    // LOAD
+    // Open + copy into a Mesh (for CPU-side work; to render, upload the
+    // MeshView instead)
+    // ==========================================================================
+    static Mesh load(const std::string& path, size_t lod = 0);
+
+    static size_t alignUp(size_t offset) {
+        return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+private:
+    static void storeVec3(float out[3], const Vec3& v) {
+        out[0] = v.x;
+        out[1] = v.y;
+        out[2] = v.z;
+    }
+
+    static void appendBytes(std::vector<uint8_t>& out, const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+};
+
+// =============================================================================
+// MeshView: An open mesh file (read-only, backed by the mapping)
+// =============================================================================
+// Spans it returns point into the mapping: valid while the view lives.
+// Move-only, like the mapping. Construction throws std::runtime_error for
+// files that can't be opened or aren't valid mesh files.
+// =============================================================================
+
+class MeshView {
+private:
+    MappedFile file;
+    MeshFileHeader header{};
+    std::vector<MeshFileLod> lods;
+
+public:
+    explicit MeshView(const std::string& path) : file(path) {
+        std::span<const uint8_t> bytes = file.bytes();
+        auto fail = [&](const char* reason) {
+            return std::runtime_error(std::string("Mesh file load failed: ") + reason + " (" + path + ")");
+        };
+
+        if (bytes.size() < sizeof(MeshFileHeader)) throw fail("truncated header");
+        std::memcpy(&header, bytes.data(), sizeof(header));   // Copy: no aliasing games
+
+        if (std::memcmp(header.magic, MeshFile::MAGIC, sizeof(MeshFile::MAGIC)) != 0) {
+            throw fail("not a mesh file");
+        }
+        if (header.version != MeshFile::VERSION) {
+            throw fail(("unsupported version " + std::to_string(header.version)).c_str());
+        }
+        if (header.vertexFormat > static_cast<uint32_t>(VertexFormat::Packed) ||
+            header.indexStorage > static_cast<uint32_t>(MeshFile::IndexStorage::Compressed)) {
+            throw fail("unknown vertex format or index storage");
+        }
+        if (header.vertexCount > std::numeric_limits<uint32_t>::max() ||
+            header.vertexBytes != header.vertexCount * vertexStride()) {
+            throw fail("vertex stream size doesn't match the vertex count");
+        }
+        if (getIndexStorage() == MeshFile::IndexStorage::Uint16 && header.vertexCount > 65536) {
+            throw fail("16-bit indices with more than 65536 vertices");
+        }
+        if (header.lodCount == 0) throw fail("no LODs");
+
+        // Every stream: aligned, inside the file (written to survive overflow)
+        auto inFile = [&](uint64_t offset, uint64_t size) {
+            return offset % MeshFile::ALIGNMENT == 0 && offset <= bytes.size() &&
+                   size <= bytes.size() - offset;
+        };
+        if (!inFile(header.vertexOffset, header.vertexBytes) ||
+            !inFile(header.indexOffset, header.indexBytes) ||
+            !inFile(header.lodOffset, uint64_t{header.lodCount} * sizeof(MeshFileLod))) {
+            throw fail("stream outside the file");
+        }
+
+        lods.resize(header.lodCount);
+        std::memcpy(lods.data(), bytes.data() + header.lodOffset, lods.size() * sizeof(MeshFileLod));
+        for (const MeshFileLod& lod : lods) {
+            bool inStream = lod.indexOffset <= header.indexBytes &&
+                            lod.indexBytes <= header.indexBytes - lod.indexOffset;
+            bool validCount = lod.indexCount % 3 == 0 &&
+                              lod.indexCount <= std::numeric_limits<uint32_t>::max();
+            // Raw: exact size. Compressed: every index takes at least a
+            // byte, which bounds what decoding will allocate.
+            bool sizeMatches = getIndexStorage() == MeshFile::IndexStorage::Compressed
+                                   ? lod.indexCount <= lod.indexBytes
+                                   : lod.indexBytes == lod.indexCount * indexSize();
+            if (!inStream || !validCount || !sizeMatches) {
+                throw fail("bad LOD table entry");
+            }
+        }
+    }
+
+    MeshView(MeshView&&) = default;
+    MeshView& operator=(MeshView&&) = default;
+
+    // ==========================================================================
+    // HEADER
+    // ==========================================================================
+    VertexFormat getVertexFormat() const { return static_cast<VertexFormat>(header.vertexFormat); }
+    MeshFile::IndexStorage getIndexStorage() const {
+        return static_cast<MeshFile::IndexStorage>(header.indexStorage);
+    }
+    size_t getVertexCount() const { return static_cast<size_t>(header.vertexCount); }
+
+    AABB getBounds() const {
+        AABB box;
+        box.min = Vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        box.max = Vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        return box;
+    }
+
+    // Packed: box 0-1 → object space (identity for float vertices)
+    Mat4 getDequantization() const {
+        if (getVertexFormat() != VertexFormat::Packed) return Mat4::identity();
+        AABB box;
+        box.min = Vec3(header.quantizationMin[0], header.quantizationMin[1], header.quantizationMin[2]);
+        box.max = Vec3(header.quantizationMax[0], header.quantizationMax[1], header.quantizationMax[2]);
+        return VertexPacking::dequantizationMatrix(box);
+    }
+
+    size_t getLodCount() const { return lods.size(); }
+    const MeshFileLod& getLod(size_t lod) const { return lods.at(lod); }
+
+    // ==========================================================================
+    // STREAMS (pointers into the mapping)
+    // ==========================================================================
+    std::span<const uint8_t> getVertexData() const {
+        return file.bytes().subspan(header.vertexOffset, header.vertexBytes);
+    }
+
+    // One LOD's stored index bytes: raw indices or IndexCodec data
+    std::span<const uint8_t> getIndexData(size_t lod) const {
+        const MeshFileLod& entry = getLod(lod);
+        return file.bytes().subspan(header.indexOffset + entry.indexOffset, entry.indexBytes);
+    }
+
+    // ==========================================================================
+    // DECODE INDICES
+    // One LOD as uint32_t, whatever the storage (copies). Throws for
+    // corrupt compressed data.
+    // ==========================================================================
+    std::vector<uint32_t> decodeIndices(size_t lod) const {
+        const MeshFileLod& entry = getLod(lod);
+        std::span<const uint8_t> data = getIndexData(lod);
+        std::vector<uint32_t> indices;
+
+        switch (getIndexStorage()) {
+            case MeshFile::IndexStorage::Compressed:
+                if (!IndexCodec::decode(data, entry.indexCount, indices)) {
+                    throw std::runtime_error("Mesh file load failed: corrupt compressed indices");
+                }
+                break;
+            case MeshFile::IndexStorage::Uint16:
+                indices.resize(entry.indexCount);
+                for (size_t i = 0; i < indices.size(); i++) {
+                    uint16_t value;
+                    std::memcpy(&value, data.data() + i * sizeof(value), sizeof(value));
+                    indices[i] = value;
+                }
+                break;
+            case MeshFile::IndexStorage::Uint32:
+                indices.resize(entry.indexCount);
+                std::memcpy(indices.data(), data.data(), data.size());
+                break;
+        }
+        return indices;
+    }
+
+    // ==========================================================================
+    // TO MESH
+    // Copy one LOD into a Mesh (packed vertices are unpacked to floats).
+    // Throws if an index is out of range.
+    // ==========================================================================
+    Mesh toMesh(size_t lod = 0) const {
+        Mesh mesh;
+        std::span<const uint8_t> vertexData = getVertexData();
+
+        if (getVertexFormat() == VertexFormat::Packed) {
+            std::vector<PackedVertex> packed(getVertexCount());
+            std::memcpy(packed.data(), vertexData.data(), vertexData.size());
+            mesh.vertices = VertexPacking::unpack(packed, getDequantization());
+        } else {
+            mesh.vertices.resize(getVertexCount());
+            std::memcpy(mesh.vertices.data(), vertexData.data(), vertexData.size());
+        }
+
+        mesh.indices = decodeIndices(lod);
+        for (uint32_t index : mesh.indices) {
+            if (index >= mesh.vertices.size()) {
+                throw std::runtime_error("Mesh file load failed: index out of range");
+            }
+        }
+
+        mesh.computeBounds();
+        return mesh;
+    }
+
+private:
+    size_t vertexStride() const {
+        return getVertexFormat() == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+
+    size_t indexSize() const {
+        return getIndexStorage() == MeshFile::IndexStorage::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+};
+
+inline Mesh MeshFile::load(const std::string& path, size_t lod) {
+    return MeshView(path).toMesh(lod);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+// =============================================================================
+// MeshHandle: Reference to a mesh living on the GPU
+// =============================================================================
+// RendererGL::uploadMesh copies a Mesh into GPU buffers and returns one of
+// these. From then on the CPU-side Mesh is no longer needed: it may move,
+// be destroyed, or be reused for something else.
+//
+// A handle is two numbers:
+// - index:      slot in the renderer's dense mesh table (O(1) lookup,
+//               no hashing)
+// - generation: bumped every time that slot is released
+//
+// Releasing a mesh frees its slot for the next upload. A handle to the old
+// mesh still carries the OLD generation, so the renderer can tell it's
+// stale and skip it, instead of silently drawing whatever moved in:
+//
+//   slot 7: gen 1 (floor)  → release → gen 2 (free) → upload → gen 2 (rock)
+//   handle {7, 1} = stale    handle {7, 2} = rock
+//
+// Generation 0 is never issued, so a default-constructed handle is
+// always invalid.
+// =============================================================================
+
+struct MeshHandle {
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    // True for default-constructed handles. (A non-null handle can still
+    // be stale - only the renderer that issued it can tell.)
+    constexpr bool isNull() const { return index == INVALID_INDEX; }
+
+    constexpr bool operator==(const MeshHandle&) const = default;
+};
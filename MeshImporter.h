@@ -0,0 +1,981 @@
+#pragma once
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "ThreadPool.h"
+#include "Color.h"
+#include "Vec3.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// =============================================================================
+// MeshImporter: OBJ / binary PLY → Mesh, spread across a ThreadPool
+// =============================================================================
+// A one-line-at-a-time loader spends its life in strtof on one core. A
+// 200 MB scan takes seconds that way - all of it before the first frame.
+//
+// STREAMING: the file is mapped (MappedFile), never read into a buffer.
+// Chunks fault their pages in as the workers reach them.
+//
+// CHUNKING:
+// - OBJ is line-based: split the mapping into ~1 MB chunks, each moved
+//   forward to just after a newline, so every line lies in ONE chunk.
+//   Pass 1 parses "v"/"vn" lines per chunk; a prefix sum over the chunk
+//   counts then gives every chunk its global vertex numbering, and pass
+//   2 builds the faces (which may point at vertices from other chunks).
+// - Binary PLY vertices are fixed-size records: any chunk of them can be
+//   decoded independently. Faces are variable-size lists; triangle-only
+//   files (nearly all) are fixed-size too, anything else takes one quick
+//   serial scan to find chunk starts.
+//
+// FLOATS: parseFloat - digits accumulated into a 64-bit integer and one
+// scale by an exact power of ten (Clinger's fast path), with
+// std::from_chars for the rare inputs that don't fit (long mantissas,
+// huge exponents, inf/nan).
+//
+// WELDING: files store shared corners by value (an OBJ corner is a
+// position/normal pair; exporters often duplicate vertices outright).
+// weld merges vertices with identical position, normal and color via a
+// hash set - itself split into hash shards processed in parallel - and
+// numbers the survivors in first-use order.
+//
+// Errors throw std::runtime_error ("OBJ import failed: ...").
+// Missing normals are generated (area-weighted, after welding). Texture
+// coordinates, materials and smoothing groups are ignored: Vertex has
+// no place for them.
+// =============================================================================
+
+struct MeshImporter {
+    // ==========================================================================
+    // LOAD (by extension: .obj or .ply)
+    // ==========================================================================
+    static Mesh load(const std::string& path, ThreadPool& pool) {
+        std::string extension = std::filesystem::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        if (extension == ".obj") return loadOBJ(path, pool);
+        if (extension == ".ply") return loadPLY(path, pool);
+        throw std::runtime_error("Mesh import failed: unknown file type " + path);
+    }
+
+    // ==========================================================================
+    // CONVERT
+    // Import, optimize (Mesh::optimize - worth it for a file loaded many
+    // times, and it makes compressed indices smaller) and write a mesh file.
+    // Only format choices here: optimize renumbers the vertices, so LOD
+    // index lists built against the source would no longer match.
+    // ==========================================================================
+    struct ConvertOptions {
+        VertexFormat vertexFormat = VertexFormat::Float;
+        bool compressIndices = false;
+    };
+
+    static void convert(const std::string& source, const std::string& destination, ThreadPool& pool) {
+        convert(source, destination, pool, ConvertOptions());
+    }
+
+    static void convert(const std::string& source, const std::string& destination, ThreadPool& pool,
+                        const ConvertOptions& options) {
+        Mesh mesh = load(source, pool);
+        mesh.optimize();
+
+        MeshFile::WriteOptions writeOptions;
+        writeOptions.vertexFormat = options.vertexFormat;
+        writeOptions.compressIndices = options.compressIndices;
+        MeshFile::write(destination, mesh, writeOptions);
+    }
+
+    // ==========================================================================
+    // OPEN CACHED
+    // The fast path for startup: open source + ".rmsh" if it is at least
+    // as new as the source, readable, and written with the requested
+    // options; otherwise convert first.
+    // Upload the result with RendererGL::uploadMesh(const MeshView&).
+    // ==========================================================================
+    static MeshView openCached(const std::string& source, ThreadPool& pool) {
+        return openCached(source, pool, ConvertOptions());
+    }
+
+    static MeshView openCached(const std::string& source, ThreadPool& pool, const ConvertOptions& options) {
+        std::string cache = source + ".rmsh";
+
+        std::error_code error;
+        auto cacheTime = std::filesystem::last_write_time(cache, error);
+        if (!error && cacheTime >= std::filesystem::last_write_time(source)) {
+            try {
+                MeshView view(cache);
+                bool compressed = view.getIndexStorage() == MeshFile::IndexStorage::Compressed;
+                if (view.getVertexFormat() == options.vertexFormat && compressed == options.compressIndices) {
+                    return view;
+                }
+                // Written with other options: rebuild below
+            } catch (const std::runtime_error&) {
+                // Stale format version or damaged: rebuild below
+            }
+        }
+
+        convert(source, cache, pool, options);
+        return MeshView(cache);
+    }
+
+    // ==========================================================================
+    // OBJ
+    // Supported: "v x y z [r g b]", "vn x y z", "f" with any corner form
+    // (i, i/t, i//n, i/t/n; negative = relative), polygons fan-triangulated
+    // ==========================================================================
+    static Mesh loadOBJ(const std::string& path, ThreadPool& pool) {
+        MappedFile file(path);
+        std::string_view text(reinterpret_cast<const char*>(file.bytes().data()), file.getSize());
+        std::vector<std::string_view> chunks = splitLines(text, OBJ_CHUNK_BYTES);
+
+        // ======================================================================
+        // PASS 1: vertex data, per chunk
+        // ======================================================================
+        struct ObjChunk {
+            std::vector<Vec3> positions;
+            std::vector<Color> colors;
+            std::vector<Vec3> normals;
+            size_t positionBase = 0;   // Global number of this chunk's first "v"
+            size_t normalBase = 0;
+            std::vector<Vertex> corners;
+            std::string error;
+        };
+        std::vector<ObjChunk> parsed(chunks.size());
+
+        pool.parallelFor(chunks.size(), [&](size_t c) {
+            ObjChunk& chunk = parsed[c];
+            forEachLine(chunks[c], [&](std::string_view line) {
+                if (!chunk.error.empty()) return;
+                if (line.starts_with("v ") || line.starts_with("v\t")) {
+                    float values[6];
+                    size_t count = parseFloats(line.substr(2), values, 6);
+                    if (count < 3) {
+                        chunk.error = "bad vertex line";
+                        return;
+                    }
+                    chunk.positions.emplace_back(values[0], values[1], values[2]);
+                    chunk.colors.push_back(count == 6 ? Color(values[3], values[4], values[5])
+                                                      : Color::WHITE);
+                } else if (line.starts_with("vn ") || line.starts_with("vn\t")) {
+                    float values[3];
+                    if (parseFloats(line.substr(3), values, 3) < 3) {
+                        chunk.error = "bad normal line";
+                        return;
+                    }
+                    chunk.normals.emplace_back(values[0], values[1], values[2]);
+                }
+            });
+        });
+        throwIfFailed(parsed, "OBJ", path);
+
+        std::vector<Vec3> positions;
+        std::vector<Color> colors;
+        std::vector<Vec3> normals;
+        for (ObjChunk& chunk : parsed) {
+            chunk.positionBase = positions.size();
+            chunk.normalBase = normals.size();
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+            chunk.positions = {};
+            chunk.colors = {};
+            chunk.normals = {};
+        }
+
+        // ======================================================================
+        // PASS 2: faces → triangle corners (one Vertex each, welded below)
+        // Relative indices count the "v"/"vn" lines above the face, so this
+        // pass tracks those too.
+        // ======================================================================
+        pool.parallelFor(chunks.size(), [&](size_t c) {
+            ObjChunk& chunk = parsed[c];
+            size_t positionCount = chunk.positionBase;
+            size_t normalCount = chunk.normalBase;
+            std::vector<Vertex> polygon;
+
+            forEachLine(chunks[c], [&](std::string_view line) {
+                if (!chunk.error.empty()) return;
+                if (line.starts_with("v ") || line.starts_with("v\t")) {
+                    positionCount++;
+                    return;
+                }
+                if (line.starts_with("vn ") || line.starts_with("vn\t")) {
+                    normalCount++;
+                    return;
+                }
+                if (!line.starts_with("f ") && !line.starts_with("f\t")) return;
+
+                polygon.clear();
+                std::string_view rest = line.substr(2);
+                for (std::string_view corner = nextToken(rest); !corner.empty(); corner = nextToken(rest)) {
+                    int64_t p = 0, t = 0, n = 0;
+                    if (!parseCorner(corner, p, t, n)) {
+                        chunk.error = "bad face corner";
+                        return;
+                    }
+                    int64_t position = resolveIndex(p, positionCount);
+                    int64_t normal = n != 0 ? resolveIndex(n, normalCount) : -1;
+                    if (position < 0 || position >= static_cast<int64_t>(positions.size()) ||
+                        (n != 0 && (normal < 0 || normal >= static_cast<int64_t>(normals.size())))) {
+                        chunk.error = "face references a missing vertex";
+                        return;
+                    }
+                    polygon.emplace_back(positions[position],
+                                         normal >= 0 ? normals[normal] : Vec3(0, 0, 0),
+                                         colors[position]);
+                }
+
+                // Fan: (0, 1, 2), (0, 2, 3), ...
+                for (size_t i = 2; i < polygon.size(); i++) {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i - 1]);
+                    chunk.corners.push_back(polygon[i]);
+                }
+            });
+        });
+        throwIfFailed(parsed, "OBJ", path);
+
+        std::vector<Vertex> corners;
+        for (ObjChunk& chunk : parsed) {
+            corners.insert(corners.end(), chunk.corners.begin(), chunk.corners.end());
+            chunk.corners = {};
+        }
+        if (corners.size() > MAX_WELD_VERTICES) {
+            throw std::runtime_error("OBJ import failed: too many triangles (" + path + ")");
+        }
+
+        std::vector<uint32_t> cornerIndices(corners.size());
+        for (size_t i = 0; i < corners.size(); i++) {
+            cornerIndices[i] = static_cast<uint32_t>(i);
+        }
+        return finish(weld(corners, cornerIndices, pool));
+    }
+
+    // ==========================================================================
+    // PLY (binary_little_endian / binary_big_endian)
+    // Vertex properties used: x y z, nx ny nz, red green blue [alpha]
+    // (uchar 0-255 or float 0-1). Faces: list "vertex_indices" (or
+    // "vertex_index"). Other elements and properties are skipped.
+    // ==========================================================================
+    static Mesh loadPLY(const std::string& path, ThreadPool& pool) {
+        MappedFile file(path);
+        std::span<const uint8_t> bytes = file.bytes();
+        auto fail = [&](const std::string& reason) {
+            return std::runtime_error("PLY import failed: " + reason + " (" + path + ")");
+        };
+
+        PlyHeader header = parsePlyHeader(bytes, fail);
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+
+        size_t offset = header.dataOffset;
+        for (const PlyElement& element : header.elements) {
+            if (element.name == "vertex") {
+                offset = readPlyVertices(bytes, offset, element, header.bigEndian, vertices, pool, fail);
+            } else if (element.name == "face") {
+                if (vertices.empty() && element.count > 0) {
+                    throw fail("faces before vertices");
+                }
+                offset = readPlyFaces(bytes, offset, element, header.bigEndian, vertices.size(),
+                                      indices, pool, fail);
+            } else {
+                offset = skipPlyElement(bytes, offset, element, header.bigEndian, fail);
+            }
+        }
+        if (vertices.size() > MAX_WELD_VERTICES) {
+            throw fail("too many vertices");
+        }
+
+        return finish(weld(vertices, indices, pool));
+    }
+
+    // ==========================================================================
+    // WELD
+    // One vertex per distinct (position, normal, color); indices remapped,
+    // vertices in first-use order, unreferenced ones dropped. Every index
+    // must be < vertices.size(). Exact matches only (-0 equals +0; NaN
+    // never matches).
+    //
+    // 1. Hash every vertex (parallel)
+    // 2. Bucket vertex numbers by hash shard, per chunk (parallel)
+    // 3. Per shard, a hash set finds each vertex's FIRST equal vertex
+    //    (parallel - equal vertices always share a shard)
+    // 4. Number the representatives in index order (serial, one array pass)
+    // ==========================================================================
+    static Mesh weld(std::span<const Vertex> vertices, std::span<const uint32_t> indices, ThreadPool& pool) {
+        size_t chunkCount = (vertices.size() + WELD_CHUNK_VERTICES - 1) / WELD_CHUNK_VERTICES;
+
+        std::vector<uint64_t> hashes(vertices.size());
+        std::vector<std::vector<std::vector<uint32_t>>> buckets(chunkCount);
+        pool.parallelFor(chunkCount, [&](size_t c) {
+            size_t begin = c * WELD_CHUNK_VERTICES;
+            size_t end = std::min(begin + WELD_CHUNK_VERTICES, vertices.size());
+            buckets[c].resize(WELD_SHARDS);
+            for (size_t v = begin; v < end; v++) {
+                hashes[v] = hashVertex(vertices[v]);
+                buckets[c][hashes[v] >> (64 - WELD_SHARD_BITS)].push_back(static_cast<uint32_t>(v));
+            }
+        });
+
+        std::vector<uint32_t> representative(vertices.size());
+        pool.parallelFor(WELD_SHARDS, [&](size_t shard) {
+            auto hash = [&](uint32_t v) { return static_cast<size_t>(hashes[v]); };
+            auto equal = [&](uint32_t a, uint32_t b) { return sameVertex(vertices[a], vertices[b]); };
+            std::unordered_set<uint32_t, decltype(hash), decltype(equal)> seen(0, hash, equal);
+
+            for (size_t c = 0; c < chunkCount; c++) {   // Chunk order = first vertex wins
+                for (uint32_t v : buckets[c][shard]) {
+                    representative[v] = *seen.insert(v).first;
+                }
+            }
+        });
+
+        constexpr uint32_t UNASSIGNED = 0xFFFFFFFFu;
+        std::vector<uint32_t> welded(vertices.size(), UNASSIGNED);
+        Mesh mesh;
+        mesh.indices.reserve(indices.size());
+        for (uint32_t index : indices) {
+            uint32_t first = representative[index];
+            if (welded[first] == UNASSIGNED) {
+                welded[first] = static_cast<uint32_t>(mesh.vertices.size());
+                mesh.vertices.push_back(vertices[first]);
+            }
+            mesh.indices.push_back(welded[first]);
+        }
+        return mesh;
+    }
+
+    // ==========================================================================
+    // PARSE FLOAT
+    // Parses a decimal float at the start of [first, last). Returns the end
+    // of the number, or nullptr if there is none.
+    //
+    // FAST PATH: up to 19 significant digits go into a uint64_t; if that's
+    // ≤ 2^53 and the decimal exponent is within ±22, both the mantissa and
+    // 10^exponent are exact doubles, so ONE multiply/divide gives the
+    // correctly rounded double (Clinger). Rounding that to float can be
+    // off by one ulp in rare halfway cases - far below anything a mesh
+    // can show. Everything else goes to std::from_chars.
+    // ==========================================================================
+    static const char* parseFloat(const char* first, const char* last, float& value) {
+        const char* p = first;
+        bool negative = false;
+        if (p != last && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            p++;
+        }
+        const char* digitsStart = p;
+
+        uint64_t mantissa = 0;
+        int significantDigits = 0;
+        int exponent = 0;
+        bool exact = true;
+        bool anyDigits = false;
+
+        auto addDigit = [&](char c, bool fraction) {
+            anyDigits = true;
+            if (mantissa == 0 && c == '0') {   // Leading zeros aren't significant
+                if (fraction) exponent--;
+                return;
+            }
+            if (significantDigits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(c - '0');
+                significantDigits++;
+                if (fraction) exponent--;
+            } else {
+                exact = false;
+            }
+        };
+
+        while (p != last && *p >= '0' && *p <= '9') addDigit(*p++, false);
+        if (p != last && *p == '.') {
+            p++;
+            while (p != last && *p >= '0' && *p <= '9') addDigit(*p++, true);
+        }
+        if (anyDigits && p != last && (*p == 'e' || *p == 'E')) {
+            const char* exponentStart = p + 1;
+            bool exponentNegative = false;
+            if (exponentStart != last && (*exponentStart == '-' || *exponentStart == '+')) {
+                exponentNegative = *exponentStart == '-';
+                exponentStart++;
+            }
+            int exponentValue = 0;
+            const char* q = exponentStart;
+            while (q != last && *q >= '0' && *q <= '9') {
+                exponentValue = std::min(exponentValue * 10 + (*q++ - '0'), 100000);
+            }
+            if (q != exponentStart) {   // "1e" is the number 1 followed by junk
+                exponent += exponentNegative ? -exponentValue : exponentValue;
+                p = q;
+            }
+        }
+
+        if (anyDigits && exact && mantissa <= (uint64_t{1} << 53) && exponent >= -22 && exponent <= 22) {
+            static constexpr double POWERS_OF_TEN[] = {
+                1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+            double result = static_cast<double>(mantissa);
+            result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+            value = static_cast<float>(negative ? -result : result);
+            return p;
+        }
+
+        // Slow path (from_chars takes no '+', so start after the sign)
+        auto [end, error] = std::from_chars(negative ? first : digitsStart, last, value);
+        if (error == std::errc::result_out_of_range) {
+            // Still a number, just beyond float: flush to 0 or infinity
+            float magnitude = exponent + significantDigits < 0 ? 0.0f : std::numeric_limits<float>::infinity();
+            value = negative ? -magnitude : magnitude;
+            return end;
+        }
+        return error == std::errc() ? end : nullptr;
+    }
+
+private:
+    // ==========================================================================
+    // TUNING
+    // ==========================================================================
+    static constexpr size_t OBJ_CHUNK_BYTES = 1 << 20;
+    static constexpr size_t PLY_CHUNK_RECORDS = 1 << 16;
+    static constexpr size_t WELD_CHUNK_VERTICES = 1 << 16;
+    static constexpr int WELD_SHARD_BITS = 6;
+    static constexpr size_t WELD_SHARDS = size_t{1} << WELD_SHARD_BITS;
+    static constexpr size_t MAX_WELD_VERTICES = 0xFFFFFFFFu;   // Mesh indices are uint32_t
+
+    // ==========================================================================
+    // WELD HELPERS
+    // ==========================================================================
+    static bool sameVertex(const Vertex& a, const Vertex& b) {
+        return a.position.x == b.position.x && a.position.y == b.position.y &&
+               a.position.z == b.position.z && a.normal.x == b.normal.x &&
+               a.normal.y == b.normal.y && a.normal.z == b.normal.z &&
+               a.color.r == b.color.r && a.color.g == b.color.g &&
+               a.color.b == b.color.b && a.color.a == b.color.a;
+    }
+
+    static uint64_t hashVertex(const Vertex& vertex) {
+        auto bits = [](float value) {
+            value += 0.0f;   // -0 → +0, so values that compare equal hash equal
+            uint32_t result;
+            std::memcpy(&result, &value, sizeof(result));
+            return static_cast<uint64_t>(result);
+        };
+        uint32_t color = vertex.color.r | (vertex.color.g << 8) | (vertex.color.b << 16) |
+                         (static_cast<uint32_t>(vertex.color.a) << 24);
+
+        uint64_t hash = 0;
+        for (uint64_t word : {bits(vertex.position.x), bits(vertex.position.y), bits(vertex.position.z),
+                              bits(vertex.normal.x), bits(vertex.normal.y), bits(vertex.normal.z),
+                              static_cast<uint64_t>(color)}) {
+            hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+            hash ^= hash >> 32;
+        }
+        // Final mix: the shard comes from the TOP bits, the set uses all
+        hash ^= hash >> 29;
+        hash *= 0xBF58476D1CE4E5B9ull;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    // ==========================================================================
+    // FINISH
+    // Normals for vertices that had none (zero-length after import):
+    // area-weighted sum of the adjacent faces (the cross product's length is
+    // twice the triangle area). Then bounds.
+    // ==========================================================================
+    static Mesh finish(Mesh mesh) {
+        std::vector<bool> missing(mesh.vertices.size());
+        bool anyMissing = false;
+        for (size_t i = 0; i < mesh.vertices.size(); i++) {
+            missing[i] = mesh.vertices[i].normal.lengthSquared() == 0.0f;
+            anyMissing = anyMissing || missing[i];
+        }
+
+        if (anyMissing) {
+            for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+                uint32_t a = mesh.indices[t], b = mesh.indices[t + 1], c = mesh.indices[t + 2];
+                Vec3 faceNormal = (mesh.vertices[b].position - mesh.vertices[a].position)
+                                      .cross(mesh.vertices[c].position - mesh.vertices[a].position);
+                for (uint32_t v : {a, b, c}) {
+                    if (missing[v]) mesh.vertices[v].normal += faceNormal;
+                }
+            }
+            for (size_t i = 0; i < mesh.vertices.size(); i++) {
+                if (!missing[i]) continue;
+                Vec3& normal = mesh.vertices[i].normal;
+                normal = normal.lengthSquared() > 0.0f ? normal.normalized() : Vec3(0, 1, 0);
+            }
+        }
+
+        mesh.computeBounds();
+        return mesh;
+    }
+
+    template <typename Chunk>
+    static void throwIfFailed(const std::vector<Chunk>& chunks, const char* format, const std::string& path) {
+        for (const Chunk& chunk : chunks) {
+            if (!chunk.error.empty()) {
+                throw std::runtime_error(std::string(format) + " import failed: " + chunk.error +
+                                         " (" + path + ")");
+            }
+        }
+    }
+
+    // ==========================================================================
+    // TEXT HELPERS
+    // ==========================================================================
+
+    // Chunks of about `chunkBytes`, each ending just after a newline
+    static std::vector<std::string_view> splitLines(std::string_view text, size_t chunkBytes) {
+        std::vector<std::string_view> chunks;
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = std::min(begin + chunkBytes, text.size());
+            if (end < text.size()) {
+                size_t newline = text.find('\n', end);
+                end = newline == std::string_view::npos ? text.size() : newline + 1;
+            }
+            chunks.push_back(text.substr(begin, end - begin));
+            begin = end;
+        }
+        return chunks;
+    }
+
+    // Calls fn with each line, leading whitespace and trailing '\r' removed
+    template <typename Fn>
+    static void forEachLine(std::string_view text, Fn&& fn) {
+        while (!text.empty()) {
+            size_t newline = text.find('\n');
+            std::string_view line = text.substr(0, newline);
+            text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+
+            size_t start = line.find_first_not_of(" \t");
+            if (start == std::string_view::npos) continue;
+            line.remove_prefix(start);
+            if (line.back() == '\r') line.remove_suffix(1);
+            fn(line);
+        }
+    }
+
+    // Next whitespace-separated token ("" at the end or at a comment)
+    static std::string_view nextToken(std::string_view& text) {
+        size_t start = text.find_first_not_of(" \t");
+        if (start == std::string_view::npos || text[start] == '#') {
+            text = {};
+            return {};
+        }
+        size_t end = text.find_first_of(" \t", start);
+        std::string_view token = text.substr(start, end == std::string_view::npos ? end : end - start);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end);
+        return token;
+    }
+
+    // Up to `maxCount` floats; returns how many were read
+    static size_t parseFloats(std::string_view text, float* values, size_t maxCount) {
+        size_t count = 0;
+        for (std::string_view token = nextToken(text); !token.empty() && count < maxCount;
+             token = nextToken(text)) {
+            const char* end = parseFloat(token.data(), token.data() + token.size(), values[count]);
+            if (end != token.data() + token.size()) break;
+            count++;
+        }
+        return count;
+    }
+
+    // "p", "p/t", "p//n" or "p/t/n" (0 = absent)
+    static bool parseCorner(std::string_view corner, int64_t& p, int64_t& t, int64_t& n) {
+        int64_t* fields[3] = {&p, &t, &n};
+        for (int field = 0; field < 3; field++) {
+            size_t slash = corner.find('/');
+            std::string_view part = corner.substr(0, slash);
+            if (!part.empty()) {
+                auto [end, error] = std::from_chars(part.data(), part.data() + part.size(), *fields[field]);
+                if (error != std::errc() || end != part.data() + part.size()) return false;
+            } else if (field == 0) {
+                return false;   // The position is required
+            }
+            if (slash == std::string_view::npos) return true;
+            corner.remove_prefix(slash + 1);
+        }
+        return false;   // More than 3 fields
+    }
+
+    // 1-based, or negative = counted back from the latest element
+    static int64_t resolveIndex(int64_t index, size_t countSoFar) {
+        return index > 0 ? index - 1 : static_cast<int64_t>(countSoFar) + index;
+    }
+
+    // ==========================================================================
+    // PLY HEADER
+    // ==========================================================================
+    enum class PlyType : uint8_t { Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64 };
+
+    struct PlyProperty {
+        std::string name;
+        PlyType type;          // Scalar type, or the list's element type
+        bool isList = false;
+        PlyType countType = PlyType::Uint8;
+    };
+
+    struct PlyElement {
+        std::string name;
+        size_t count = 0;
+        std::vector<PlyProperty> properties;
+    };
+
+    struct PlyHeader {
+        bool bigEndian = false;
+        size_t dataOffset = 0;
+        std::vector<PlyElement> elements;
+    };
+
+    static size_t plySize(PlyType type) {
+        switch (type) {
+            case PlyType::Int8: case PlyType::Uint8: return 1;
+            case PlyType::Int16: case PlyType::Uint16: return 2;
+            case PlyType::Int32: case PlyType::Uint32: case PlyType::Float32: return 4;
+            case PlyType::Float64: return 8;
+        }
+        return 0;
+    }
+
+    static bool isPlyInteger(PlyType type) {
+        return type != PlyType::Float32 && type != PlyType::Float64;
+    }
+
+    static bool parsePlyType(std::string_view name, PlyType& type) {
+        static constexpr std::pair<std::string_view, PlyType> NAMES[] = {
+            {"char", PlyType::Int8},     {"int8", PlyType::Int8},
+            {"uchar", PlyType::Uint8},   {"uint8", PlyType::Uint8},
+            {"short", PlyType::Int16},   {"int16", PlyType::Int16},
+            {"ushort", PlyType::Uint16}, {"uint16", PlyType::Uint16},
+            {"int", PlyType::Int32},     {"int32", PlyType::Int32},
+            {"uint", PlyType::Uint32},   {"uint32", PlyType::Uint32},
+            {"float", PlyType::Float32}, {"float32", PlyType::Float32},
+            {"double", PlyType::Float64}, {"float64", PlyType::Float64}};
+        for (const auto& [typeName, value] : NAMES) {
+            if (typeName == name) {
+                type = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Fail>
+    static PlyHeader parsePlyHeader(std::span<const uint8_t> bytes, const Fail& fail) {
+        std::string_view text(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        if (!text.starts_with("ply")) throw fail("not a PLY file");
+
+        size_t end = text.find("end_header");
+        if (end == std::string_view::npos) throw fail("no end_header");
+        size_t newline = text.find('\n', end);
+        if (newline == std::string_view::npos) throw fail("no data");
+
+        PlyHeader header;
+        header.dataOffset = newline + 1;
+        bool formatSeen = false;
+
+        forEachLine(text.substr(0, end), [&](std::string_view line) {
+            std::string_view rest = line;
+            std::string_view keyword = nextToken(rest);
+
+            if (keyword == "format") {
+                std::string_view format = nextToken(rest);
+                if (format == "ascii") throw fail("ascii PLY is not supported, only binary");
+                if (format != "binary_little_endian" && format != "binary_big_endian") {
+                    throw fail("unknown format");
+                }
+                header.bigEndian = format == "binary_big_endian";
+                formatSeen = true;
+            } else if (keyword == "element") {
+                PlyElement element;
+                element.name = nextToken(rest);
+                std::string_view count = nextToken(rest);
+                auto [countEnd, error] = std::from_chars(count.data(), count.data() + count.size(), element.count);
+                if (error != std::errc() || countEnd != count.data() + count.size()) {
+                    throw fail("bad element count");
+                }
+                header.elements.push_back(element);
+            } else if (keyword == "property") {
+                if (header.elements.empty()) throw fail("property outside an element");
+                PlyProperty property;
+                std::string_view type = nextToken(rest);
+                if (type == "list") {
+                    property.isList = true;
+                    // Counts size the records: a float count (NaN, 2.5) has no meaning
+                    if (!parsePlyType(nextToken(rest), property.countType) || !isPlyInteger(property.countType)) {
+                        throw fail("bad list count type");
+                    }
+                    type = nextToken(rest);
+                }
+                if (!parsePlyType(type, property.type)) throw fail("bad property type");
+                property.name = nextToken(rest);
+                header.elements.back().properties.push_back(property);
+            }
+        });
+
+        if (!formatSeen) throw fail("no format line");
+        return header;
+    }
+
+    // ==========================================================================
+    // PLY DATA
+    // ==========================================================================
+    static double readPlyValue(const uint8_t* data, PlyType type, bool bigEndian) {
+        uint8_t raw[8];
+        size_t size = plySize(type);
+        for (size_t i = 0; i < size; i++) {
+            raw[i] = data[bigEndian ? size - 1 - i : i];
+        }
+
+        auto as = [&]<typename T>(T) {
+            T value;
+            std::memcpy(&value, raw, sizeof(T));
+            return static_cast<double>(value);
+        };
+        switch (type) {
+            case PlyType::Int8: return as(int8_t{});
+            case PlyType::Uint8: return as(uint8_t{});
+            case PlyType::Int16: return as(int16_t{});
+            case PlyType::Uint16: return as(uint16_t{});
+            case PlyType::Int32: return as(int32_t{});
+            case PlyType::Uint32: return as(uint32_t{});
+            case PlyType::Float32: return as(float{});
+            case PlyType::Float64: return as(double{});
+        }
+        return 0.0;
+    }
+
+    // Bytes of one record at `offset` (any list counts included), or 0 if
+    // it runs past the end
+    static size_t plyRecordSize(std::span<const uint8_t> bytes, size_t offset,
+                                const PlyElement& element, bool bigEndian) {
+        size_t size = 0;
+        for (const PlyProperty& property : element.properties) {
+            if (!property.isList) {
+                size += plySize(property.type);
+                continue;
+            }
+            size_t countSize = plySize(property.countType);
+            if (offset + size + countSize > bytes.size()) return 0;
+            double count = readPlyValue(bytes.data() + offset + size, property.countType, bigEndian);
+            if (!(count >= 0)) return 0;
+            size += countSize + static_cast<size_t>(count) * plySize(property.type);
+        }
+        return offset + size <= bytes.size() ? size : 0;
+    }
+
+    static bool hasLists(const PlyElement& element) {
+        return std::any_of(element.properties.begin(), element.properties.end(),
+                           [](const PlyProperty& property) { return property.isList; });
+    }
+
+    template <typename Fail>
+    static size_t skipPlyElement(std::span<const uint8_t> bytes, size_t offset, const PlyElement& element,
+                                 bool bigEndian, const Fail& fail) {
+        if (!hasLists(element)) {
+            size_t size = plyRecordSize(bytes, offset, element, bigEndian);
+            if (element.count > 0 && (size == 0 || element.count > (bytes.size() - offset) / size)) {
+                throw fail("truncated " + element.name + " data");
+            }
+            return offset + element.count * size;
+        }
+        for (size_t i = 0; i < element.count; i++) {
+            size_t size = plyRecordSize(bytes, offset, element, bigEndian);
+            if (size == 0) throw fail("truncated " + element.name + " data");
+            offset += size;
+        }
+        return offset;
+    }
+
+    // Fixed-size records: decoded in parallel chunks straight into place
+    template <typename Fail>
+    static size_t readPlyVertices(std::span<const uint8_t> bytes, size_t offset, const PlyElement& element,
+                                  bool bigEndian, std::vector<Vertex>& vertices, ThreadPool& pool,
+                                  const Fail& fail) {
+        if (hasLists(element)) throw fail("list properties on vertices");
+
+        // Byte offset of each used property within a record (NONE = absent)
+        constexpr size_t NONE = ~size_t{0};
+        static constexpr const char* FIELDS[] = {"x", "y", "z", "nx", "ny", "nz",
+                                                 "red", "green", "blue", "alpha"};
+        size_t fieldOffset[10];
+        PlyType fieldType[10] = {};
+        std::fill(std::begin(fieldOffset), std::end(fieldOffset), NONE);
+
+        size_t stride = 0;
+        for (const PlyProperty& property : element.properties) {
+            for (size_t f = 0; f < 10; f++) {
+                if (property.name == FIELDS[f]) {
+                    fieldOffset[f] = stride;
+                    fieldType[f] = property.type;
+                }
+            }
+            stride += plySize(property.type);
+        }
+        if (fieldOffset[0] == NONE || fieldOffset[1] == NONE || fieldOffset[2] == NONE) {
+            throw fail("vertices without x, y, z");
+        }
+        if (element.count > 0 && element.count > (bytes.size() - offset) / stride) {
+            throw fail("truncated vertex data");
+        }
+        bool hasNormals = fieldOffset[3] != NONE && fieldOffset[4] != NONE && fieldOffset[5] != NONE;
+
+        vertices.resize(element.count);
+        size_t chunkCount = (element.count + PLY_CHUNK_RECORDS - 1) / PLY_CHUNK_RECORDS;
+        pool.parallelFor(chunkCount, [&](size_t c) {
+            size_t begin = c * PLY_CHUNK_RECORDS;
+            size_t end = std::min(begin + PLY_CHUNK_RECORDS, element.count);
+
+            for (size_t v = begin; v < end; v++) {
+                const uint8_t* record = bytes.data() + offset + v * stride;
+                auto field = [&](size_t f) {
+                    return static_cast<float>(readPlyValue(record + fieldOffset[f], fieldType[f], bigEndian));
+                };
+                // uchar colors are 0-255, float colors 0-1
+                auto channel = [&](size_t f) {
+                    if (fieldOffset[f] == NONE) return uint8_t{255};
+                    float value = field(f);
+                    if (plySize(fieldType[f]) > 1) value = std::clamp(value, 0.0f, 1.0f) * 255.0f;
+                    return static_cast<uint8_t>(std::clamp(value, 0.0f, 255.0f));
+                };
+
+                Vertex& vertex = vertices[v];
+                vertex.position = Vec3(field(0), field(1), field(2));
+                vertex.normal = hasNormals ? Vec3(field(3), field(4), field(5)) : Vec3(0, 0, 0);
+                vertex.color = Color(channel(6), channel(7), channel(8), channel(9));
+            }
+        });
+        return offset + element.count * stride;
+    }
+
+    // Faces → triangle indices. Triangle-only files are fixed-size records
+    // (checked in parallel); otherwise a serial scan finds chunk starts.
+    template <typename Fail>
+    static size_t readPlyFaces(std::span<const uint8_t> bytes, size_t offset, const PlyElement& element,
+                               bool bigEndian, size_t vertexCount, std::vector<uint32_t>& indices,
+                               ThreadPool& pool, const Fail& fail) {
+        const PlyProperty* list = nullptr;
+        size_t listOffset = 0;   // Bytes before the list in each record (scalars only)
+        for (const PlyProperty& property : element.properties) {
+            if (!property.isList) {
+                if (list == nullptr) listOffset += plySize(property.type);
+                continue;
+            }
+            if (list != nullptr || (property.name != "vertex_indices" && property.name != "vertex_index")) {
+                throw fail("face lists other than vertex_indices");
+            }
+            list = &property;
+        }
+        if (list == nullptr) throw fail("faces without vertex_indices");
+        if (!isPlyInteger(list->type)) throw fail("non-integer vertex_indices");
+
+        // ======================================================================
+        // FIND CHUNKS
+        // ======================================================================
+        size_t countSize = plySize(list->countType);
+        size_t indexSize = plySize(list->type);
+        size_t triangleRecord = plyRecordSizeIfTriangle(element, countSize, indexSize);
+
+        std::vector<size_t> chunkOffsets;   // Byte offset of each chunk's first face
+        size_t end = offset;
+        bool allTriangles = triangleRecord > 0 && element.count <= (bytes.size() - offset) / triangleRecord;
+        if (allTriangles) {
+            size_t chunkCount = (element.count + PLY_CHUNK_RECORDS - 1) / PLY_CHUNK_RECORDS;
+            std::vector<uint8_t> chunkOk(chunkCount);
+            pool.parallelFor(chunkCount, [&](size_t c) {
+                size_t last = std::min((c + 1) * PLY_CHUNK_RECORDS, element.count);
+                bool ok = true;
+                for (size_t f = c * PLY_CHUNK_RECORDS; f < last && ok; f++) {
+                    const uint8_t* count = bytes.data() + offset + f * triangleRecord + listOffset;
+                    ok = readPlyValue(count, list->countType, bigEndian) == 3.0;
+                }
+                chunkOk[c] = ok;
+            });
+            allTriangles = std::all_of(chunkOk.begin(), chunkOk.end(), [](uint8_t ok) { return ok; });
+            for (size_t c = 0; allTriangles && c < chunkCount; c++) {
+                chunkOffsets.push_back(offset + c * PLY_CHUNK_RECORDS * triangleRecord);
+            }
+            end = offset + element.count * triangleRecord;
+        }
+        if (!allTriangles) {
+            chunkOffsets.clear();
+            end = offset;
+            for (size_t f = 0; f < element.count; f++) {
+                if (f % PLY_CHUNK_RECORDS == 0) chunkOffsets.push_back(end);
+                size_t size = plyRecordSize(bytes, end, element, bigEndian);
+                if (size == 0) throw fail("truncated face data");
+                end += size;
+            }
+        }
+
+        // ======================================================================
+        // DECODE CHUNKS (fan-triangulating polygons)
+        // ======================================================================
+        struct FaceChunk {
+            std::vector<uint32_t> indices;
+            std::string error;
+        };
+        std::vector<FaceChunk> chunks(chunkOffsets.size());
+
+        pool.parallelFor(chunks.size(), [&](size_t c) {
+            FaceChunk& chunk = chunks[c];
+            size_t position = chunkOffsets[c];
+            size_t last = std::min((c + 1) * PLY_CHUNK_RECORDS, element.count);
+            std::vector<uint32_t> polygon;
+
+            for (size_t f = c * PLY_CHUNK_RECORDS; f < last; f++) {
+                size_t record = position;
+                position += allTriangles ? triangleRecord : plyRecordSize(bytes, record, element, bigEndian);
+
+                const uint8_t* data = bytes.data() + record + listOffset;
+                size_t count = static_cast<size_t>(readPlyValue(data, list->countType, bigEndian));
+                data += countSize;
+
+                polygon.clear();
+                for (size_t i = 0; i < count; i++) {
+                    double index = readPlyValue(data + i * indexSize, list->type, bigEndian);
+                    if (!(index >= 0 && index < static_cast<double>(vertexCount))) {
+                        chunk.error = "face references a missing vertex";
+                        return;
+                    }
+                    polygon.push_back(static_cast<uint32_t>(index));
+                }
+                for (size_t i = 2; i < polygon.size(); i++) {
+                    chunk.indices.insert(chunk.indices.end(), {polygon[0], polygon[i - 1], polygon[i]});
+                }
+            }
+        });
+        for (const FaceChunk& chunk : chunks) {
+            if (!chunk.error.empty()) throw fail(chunk.error);
+        }
+
+        for (FaceChunk& chunk : chunks) {
+            indices.insert(indices.end(), chunk.indices.begin(), chunk.indices.end());
+        }
+        return end;
+    }
+
+    // Record size if every face is a triangle (the list is the only
+    // variable-size property, see readPlyFaces)
+    static size_t plyRecordSizeIfTriangle(const PlyElement& element, size_t countSize, size_t indexSize) {
+        size_t size = 0;
+        for (const PlyProperty& property : element.properties) {
+            size += property.isList ? countSize + 3 * indexSize : plySize(property.type);
+        }
+        return size;
+    }
+};
@@ -0,0 +1,447 @@
+#pragma once
+#include "Vec3.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+// =============================================================================
+// MeshOptimizer: Reorder index and vertex buffers for the GPU
+// =============================================================================
+// The generators (and most file formats) emit triangles in whatever order
+// was convenient to write: row by row, face by face. The GPU doesn't care
+// about the ORDER for the image, but it matters a lot for speed:
+//
+// 1. POST-TRANSFORM CACHE
+//    The vertex shader's results for the last few indices are kept in a
+//    small cache. A triangle whose vertices were just used reuses them
+//    for free; every miss runs the vertex shader again. Same mesh, same
+//    triangles - but a good order can cut vertex shader work by 2x or more.
+//
+// 2. OVERDRAW
+//    With depth testing, pixels hidden behind already-drawn surfaces are
+//    rejected early. Drawing the outer, front-most parts of a mesh first
+//    means fewer pixels get shaded and then overwritten.
+//
+// 3. VERTEX FETCH
+//    Vertices are read from memory in index order. If vertex 0 is used,
+//    then vertex 900, then vertex 3, every fetch is a new cache line.
+//    Storing vertices in first-use order makes the reads sequential.
+//
+// Run them in that order: overdraw reordering moves whole clusters of
+// cache-friendly triangles around, and fetch remapping only renames
+// vertices (indices change, triangle order doesn't).
+//
+// MEASURING (analyzeVertexCache):
+// - ACMR: average cache miss ratio = transformed vertices / triangles.
+//   Worst case 3.0; ~0.5 is the limit for large regular grids
+// - ATVR: average transformed vertex ratio = transformed / unique vertices.
+//   1.0 = every vertex shaded exactly once (perfect)
+// =============================================================================
+
+struct MeshOptimizer {
+    struct CacheStats {
+        float acmr = 0.0f;   // Transformed vertices per triangle (lower = better)
+        float atvr = 0.0f;   // Transformed vertices per vertex (1.0 = ideal)
+    };
+
+    // FIFO size used for measuring. Real hardware varies (and is often not
+    // a plain FIFO); 16 is a common, conservative stand-in.
+    static constexpr size_t ANALYZE_CACHE_SIZE = 16;
+
+    // ==========================================================================
+    // ANALYZE VERTEX CACHE
+    // Simulate a FIFO post-transform cache over the index buffer
+    // ==========================================================================
+    static CacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+                                         size_t cacheSize = ANALYZE_CACHE_SIZE) {
+        CacheStats stats;
+        if (indices.size() < 3 || vertexCount == 0) return stats;
+
+        // Timestamp of each vertex's last transform; in cache while
+        // fewer than cacheSize other vertices were transformed since
+        std::vector<size_t> transformedAt(vertexCount, 0);
+        std::vector<bool> used(vertexCount, false);
+        size_t transformed = 0;
+        size_t uniqueVertices = 0;
+
+        for (uint32_t index : indices) {
+            if (!used[index]) {
+                used[index] = true;
+                uniqueVertices++;
+            }
+            if (transformedAt[index] == 0 || transformed + 1 - transformedAt[index] > cacheSize) {
+                transformed++;
+                transformedAt[index] = transformed;
+            }
+        }
+
+        stats.acmr = static_cast<float>(transformed) / static_cast<float>(indices.size() / 3);
+        stats.atvr = static_cast<float>(transformed) / static_cast<float>(uniqueVertices);
+        return stats;
+    }
+
+    // ==========================================================================
+    // VERTEX CACHE OPTIMIZATION (Tom Forsyth's linear-speed algorithm)
+    // ==========================================================================
+    // Greedy: always emit the triangle with the highest SCORE next. A
+    // triangle's score is the sum of its vertices' scores, and a vertex
+    // scores high when:
+    // - it's near the front of a simulated LRU cache (cheap to reuse now)
+    // - it has few triangles left (finish it off, so it doesn't need a
+    //   second transform much later)
+    //
+    // Only vertices in the cache change score after an emit, so only their
+    // triangles are rescored: linear time in practice.
+    // ==========================================================================
+    static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0 || vertexCount == 0) return;
+
+        // ======================================================================
+        // ADJACENCY: triangles of each vertex (CSR: offsets + flat list)
+        // ======================================================================
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            liveTriangles[indices[i]]++;
+        }
+
+        std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++) {
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+        }
+        std::vector<uint32_t> adjacency(adjacencyOffset[vertexCount]);
+        std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int k = 0; k < 3; k++) {
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        // ======================================================================
+        // INITIAL VERTEX SCORES (nothing cached yet: valence boost only)
+        // ======================================================================
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            vertexScore[v] = forsythScore(-1, liveTriangles[v]);
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+
+        // ======================================================================
+        // GREEDY EMIT
+        // ======================================================================
+        std::vector<uint32_t> result;
+        result.reserve(triangleCount * 3);
+
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        cache.reserve(FORSYTH_CACHE_SIZE + 3);
+        nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+        size_t scanCursor = 0;   // Fallback: next never-emitted triangle in input order
+        int64_t best = nextUnemitted(emitted, scanCursor);
+
+        while (best >= 0) {
+            uint32_t triangle = static_cast<uint32_t>(best);
+            emitted[triangle] = true;
+            const uint32_t* corners = &indices[triangle * 3];
+
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = corners[k];
+                result.push_back(v);
+
+                // Remove the triangle from the vertex's live list
+                uint32_t begin = adjacencyOffset[v];
+                uint32_t end = begin + liveTriangles[v];
+                for (uint32_t a = begin; a < end; a++) {
+                    if (adjacency[a] == triangle) {
+                        std::swap(adjacency[a], adjacency[end - 1]);
+                        break;
+                    }
+                }
+                liveTriangles[v]--;
+            }
+
+            // New LRU order: this triangle's vertices first, then the rest
+            nextCache.assign(corners, corners + 3);
+            for (uint32_t v : cache) {
+                if (v != corners[0] && v != corners[1] && v != corners[2]) {
+                    nextCache.push_back(v);
+                }
+            }
+
+            // Rescore everything that was or is in the cache (evicted
+            // vertices drop to position -1)
+            for (size_t i = 0; i < nextCache.size(); i++) {
+                uint32_t v = nextCache[i];
+                int position = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+                vertexScore[v] = forsythScore(position, liveTriangles[v]);
+            }
+            if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+                nextCache.resize(FORSYTH_CACHE_SIZE);
+            }
+            std::swap(cache, nextCache);
+
+            // Rescore the affected triangles, picking the best as we go
+            best = -1;
+            float bestScore = -1.0f;
+            for (uint32_t v : cache) {
+                uint32_t begin = adjacencyOffset[v];
+                for (uint32_t a = begin; a < begin + liveTriangles[v]; a++) {
+                    uint32_t t = adjacency[a];
+                    float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+                                  vertexScore[indices[t * 3 + 2]];
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = t;
+                    }
+                }
+            }
+
+            // Cache ran dry (an island was finished): start anywhere new
+            if (best < 0) {
+                best = nextUnemitted(emitted, scanCursor);
+            }
+        }
+
+        indices.swap(result);
+    }
+
+    // ==========================================================================
+    // OVERDRAW OPTIMIZATION (Sander, Nehab & Barczak, "Fast Triangle
+    // Reordering for Vertex Locality and Reduced Overdraw")
+    // ==========================================================================
+    // Takes a cache-optimized index buffer and:
+    // 1. Cuts it into CLUSTERS where the cache would restart anyway (a
+    //    triangle with three cache misses), then cuts those further while
+    //    the running ACMR stays within `threshold` of the cluster's own,
+    //    so reordering clusters costs (almost) no cache efficiency
+    // 2. Sorts the clusters so the ones facing AWAY from the mesh center
+    //    come first: from most viewpoints they're the front-most surfaces,
+    //    and whatever's behind them then fails the depth test
+    //
+    // threshold = 1.05 allows ACMR to get at most 5% worse.
+    // ==========================================================================
+    static void optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vec3> positions,
+                                 float threshold = 1.05f) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2 || positions.empty()) return;
+
+        std::vector<size_t> clusterStarts = hardBoundaries(indices, positions.size());
+        clusterStarts = softBoundaries(indices, positions.size(), clusterStarts, threshold);
+
+        // ======================================================================
+        // CLUSTER SORT KEYS
+        // Area-weighted centroid and normal of each cluster vs the mesh
+        // centroid: dot > 0 = cluster faces outward
+        // ======================================================================
+        Vec3 meshCentroid(0, 0, 0);
+        float meshArea = 0.0f;
+        size_t clusterCount = clusterStarts.size();
+        std::vector<Vec3> clusterCentroid(clusterCount, Vec3(0, 0, 0));
+        std::vector<Vec3> clusterNormal(clusterCount, Vec3(0, 0, 0));
+        std::vector<float> clusterArea(clusterCount, 0.0f);
+
+        for (size_t c = 0; c < clusterCount; c++) {
+            size_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+            for (size_t t = clusterStarts[c]; t < end; t++) {
+                const Vec3& p0 = positions[indices[t * 3]];
+                const Vec3& p1 = positions[indices[t * 3 + 1]];
+                const Vec3& p2 = positions[indices[t * 3 + 2]];
+                Vec3 normal = (p1 - p0).cross(p2 - p0);   // Length = 2 * area
+                float area = normal.length();
+                Vec3 center = (p0 + p1 + p2) / 3.0f;
+
+                clusterCentroid[c] += center * area;
+                clusterNormal[c] += normal;
+                clusterArea[c] += area;
+                meshCentroid += center * area;
+                meshArea += area;
+            }
+        }
+        if (meshArea > 0.0f) meshCentroid = meshCentroid / meshArea;
+
+        std::vector<float> sortKey(clusterCount, 0.0f);
+        for (size_t c = 0; c < clusterCount; c++) {
+            if (clusterArea[c] <= 0.0f) continue;
+            Vec3 centroid = clusterCentroid[c] / clusterArea[c];
+            float normalLength = clusterNormal[c].length();
+            if (normalLength > 0.0f) {
+                sortKey[c] = (centroid - meshCentroid).dot(clusterNormal[c] / normalLength);
+            }
+        }
+
+        std::vector<size_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::stable_sort(order.begin(), order.end(),
+                         [&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (size_t c : order) {
+            size_t end = c + 1 < clusterCount ? clusterStarts[c + 1] : triangleCount;
+            result.insert(result.end(), indices.begin() + clusterStarts[c] * 3,
+                          indices.begin() + end * 3);
+        }
+        indices.swap(result);
+    }
+
+    // ==========================================================================
+    // VERTEX FETCH REMAP
+    // Returns remap[old] = new, numbering vertices in order of first use
+    // and rewriting the indices to match. Vertices no index refers to map
+    // to INVALID_REMAP (drop them). Returns the new vertex count in
+    // `usedVertices`.
+    // ==========================================================================
+    static constexpr uint32_t INVALID_REMAP = 0xFFFFFFFFu;
+
+    static std::vector<uint32_t> optimizeVertexFetchRemap(std::vector<uint32_t>& indices,
+                                                          size_t vertexCount,
+                                                          size_t& usedVertices) {
+        std::vector<uint32_t> remap(vertexCount, INVALID_REMAP);
+        uint32_t next = 0;
+        for (uint32_t& index : indices) {
+            if (remap[index] == INVALID_REMAP) {
+                remap[index] = next++;
+            }
+            index = remap[index];
+        }
+        usedVertices = next;
+        return remap;
+    }
+
+private:
+    // ==========================================================================
+    // FORSYTH SCORING
+    // Constants from the original write-up
+    // ==========================================================================
+    static constexpr size_t FORSYTH_CACHE_SIZE = 32;
+    static constexpr float CACHE_DECAY_POWER = 1.5f;
+    static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    static float forsythScore(int cachePosition, uint32_t liveTriangles) {
+        if (liveTriangles == 0) return -1.0f;   // Done: nothing left to gain
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // Used by the triangle just emitted: deliberately a little
+                // lower, or the same strip would always win
+                score = LAST_TRIANGLE_SCORE;
+            } else {
+                float scale = 1.0f / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scale,
+                                 CACHE_DECAY_POWER);
+            }
+        }
+
+        score += VALENCE_BOOST_SCALE *
+                 std::pow(static_cast<float>(liveTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    // Restart point when the cache holds no live triangles: the next
+    // unemitted triangle in input order (neighbours in the input are
+    // usually neighbours on the surface, and the cursor never moves back,
+    // so all restarts together cost one pass)
+    static int64_t nextUnemitted(const std::vector<bool>& emitted, size_t& cursor) {
+        while (cursor < emitted.size() && emitted[cursor]) cursor++;
+        return cursor < emitted.size() ? static_cast<int64_t>(cursor) : -1;
+    }
+
+    // ==========================================================================
+    // CLUSTER BOUNDARIES (for optimizeOverdraw)
+    // ==========================================================================
+    // Hard boundary: a triangle whose 3 vertices all miss the cache - the
+    // cache optimizer started a new region there
+    static std::vector<size_t> hardBoundaries(std::span<const uint32_t> indices,
+                                              size_t vertexCount) {
+        std::vector<size_t> starts{0};
+        std::vector<size_t> transformedAt(vertexCount, 0);
+        size_t transformed = 0;
+
+        for (size_t t = 0; t < indices.size() / 3; t++) {
+            int misses = 0;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                if (transformedAt[v] == 0 ||
+                    transformed + 1 - transformedAt[v] > ANALYZE_CACHE_SIZE) {
+                    transformed++;
+                    transformedAt[v] = transformed;
+                    misses++;
+                }
+            }
+            if (misses == 3 && t > 0) starts.push_back(t);
+        }
+        return starts;
+    }
+
+    // Soft boundaries inside each hard cluster: split wherever the running
+    // ACMR (cache restarted at the last split) is already below the whole
+    // cluster's ACMR * threshold
+    static std::vector<size_t> softBoundaries(std::span<const uint32_t> indices,
+                                              size_t vertexCount,
+                                              const std::vector<size_t>& hardStarts,
+                                              float threshold) {
+        size_t triangleCount = indices.size() / 3;
+        std::vector<size_t> starts;
+
+        // One timestamp array for everything: "restarting" the cache just
+        // means treating every timestamp up to `restart` as a miss
+        std::vector<size_t> transformedAt(vertexCount, 0);
+        size_t transformed = 0;
+        size_t restart = 0;
+        auto transform = [&](size_t t) {
+            size_t misses = 0;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                if (transformedAt[v] <= restart ||
+                    transformed + 1 - transformedAt[v] > ANALYZE_CACHE_SIZE) {
+                    transformed++;
+                    transformedAt[v] = transformed;
+                    misses++;
+                }
+            }
+            return misses;
+        };
+
+        for (size_t h = 0; h < hardStarts.size(); h++) {
+            size_t begin = hardStarts[h];
+            size_t end = h + 1 < hardStarts.size() ? hardStarts[h + 1] : triangleCount;
+
+            // Whole-cluster ACMR first
+            restart = transformed;
+            size_t clusterMisses = 0;
+            for (size_t t = begin; t < end; t++) clusterMisses += transform(t);
+            float clusterAcmr = static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+            restart = transformed;
+            size_t splitStart = begin;
+            size_t splitMisses = 0;
+            starts.push_back(begin);
+
+            for (size_t t = begin; t < end; t++) {
+                splitMisses += transform(t);
+
+                // Don't split off slivers: a few triangles always look cheap
+                size_t triangles = t + 1 - splitStart;
+                float runningAcmr = static_cast<float>(splitMisses) / static_cast<float>(triangles);
+                if (t + 1 < end && triangles >= MIN_CLUSTER_TRIANGLES &&
+                    runningAcmr <= clusterAcmr * threshold) {
+                    starts.push_back(t + 1);
+                    splitStart = t + 1;
+                    splitMisses = 0;
+                    restart = transformed;
+                }
+            }
+        }
+        return starts;
+    }
+
+    static constexpr size_t MIN_CLUSTER_TRIANGLES = 16;
+};
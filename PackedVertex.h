@@ -0,0 +1,181 @@
+#pragma once
+#include "Mesh.h"
+#include "Bounds.h"
+#include "Mat4.h"
+#include "Vec3.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// =============================================================================
+// PackedVertex: 16-byte GPU vertex (vs 28 bytes for Vertex)
+// =============================================================================
+// Vertex keeps full floats because the CPU edits and transforms it. The
+// GPU only READS vertices, and most of those bits are wasted precision:
+//
+//   Vertex:       position 3 x float   12 bytes
+//                 normal   3 x float   12 bytes
+//                 color    RGBA8        4 bytes   = 28 bytes
+//
+//   PackedVertex: position 3 x unorm16  6 bytes (+2 padding, keeps 8-byte alignment)
+//                 normal   10_10_10_2   4 bytes (octahedral)
+//                 color    RGBA8        4 bytes   = 16 bytes
+//
+// The vertex fetch hardware converts every field back to floats for free
+// (normalized attributes), so the shaders barely notice.
+//
+// POSITIONS: 16-bit, relative to the mesh's bounding box
+// Each axis is stored as 0..65535 across the box: min → 0, max → 65535.
+// For a 10 m object that's a step of 0.15 mm. The GPU hands the shader
+// 0..1 per axis; turning that back into object space is a scale and a
+// translate - which we fold into the MODEL MATRIX (dequantizationMatrix),
+// so the shaders need no extra math and no extra data.
+//
+// NORMALS: octahedral encoding
+// A unit normal only has 2 degrees of freedom. Project the unit sphere
+// onto an octahedron (|x| + |y| + |z| = 1), unfold the lower half over
+// the upper one, and the octahedron flattens into the square [-1, 1]²:
+//
+//        upper half (z >= 0): the diamond in the middle
+//        lower half (z < 0):  folded out into the four corners
+//
+// Two 10-bit components keep every normal within 0.25° - well below
+// what lighting shows. The spare 2-bit field is set to -1: the shaders
+// decode normals whose 4th component is negative, while float Vertex
+// normals read as w = 1 (the default for a missing component). Both
+// formats therefore run through the same shader programs.
+// =============================================================================
+
+enum class VertexFormat : uint8_t {
+    Float,    // Vertex as-is (28 bytes)
+    Packed    // PackedVertex (16 bytes)
+};
+
+struct PackedVertex {
+    uint16_t position[4];   // xyz unorm16 within the mesh box, [3] = padding
+    uint32_t normal;        // Octahedral x, y as snorm10; z = 0; w (2 bits) = -1
+    uint8_t color[4];       // RGBA8
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+namespace VertexPacking {
+
+// =============================================================================
+// BOX USED FOR QUANTIZATION
+// The exact box of the vertices (independent of Mesh::bounds, which may be
+// missing or stale)
+// =============================================================================
+inline AABB quantizationBounds(std::span<const Vertex> vertices) {
+    AABB box;
+    for (const Vertex& vertex : vertices) {
+        box.expand(vertex.position);
+    }
+    return box;
+}
+
+// =============================================================================
+// DEQUANTIZATION MATRIX
+// 0..1 per axis → object space: translate(min) * scale(size).
+// The renderer draws packed meshes with model * this matrix.
+// =============================================================================
+inline Mat4 dequantizationMatrix(const AABB& box) {
+    if (box.isEmpty()) return Mat4::identity();
+    return Mat4::translate(box.min) * Mat4::scale(box.max - box.min);
+}
+
+// =============================================================================
+// OCTAHEDRAL NORMAL → 10_10_10_2 (GL_INT_2_10_10_10_REV layout:
+// x in bits 0-9, y in 10-19, z in 20-29, w in 30-31, all two's complement)
+// =============================================================================
+inline uint32_t packNormal(const Vec3& normal) {
+    float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    float u = sum > 0.0f ? normal.x / sum : 0.0f;
+    float v = sum > 0.0f ? normal.y / sum : 0.0f;
+
+    // Lower hemisphere: fold over the diagonals into the corners
+    if (normal.z < 0.0f) {
+        float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = foldedU;
+        v = foldedV;
+    }
+
+    auto snorm10 = [](float value) {
+        int quantized = static_cast<int>(std::lround(std::clamp(value, -1.0f, 1.0f) * 511.0f));
+        return static_cast<uint32_t>(quantized) & 0x3FFu;
+    };
+    constexpr uint32_t W_MINUS_ONE = 0x3u;   // 2-bit two's complement -1: "octahedral"
+
+    return snorm10(u) | (snorm10(v) << 10) | (W_MINUS_ONE << 30);
+}
+
+// CPU mirror of the shaders' decodeNormal (for tools and checks)
+inline Vec3 unpackNormal(uint32_t packed) {
+    auto snorm10 = [](uint32_t bits) {
+        int value = static_cast<int>(bits & 0x3FFu);
+        if (value >= 512) value -= 1024;   // Sign-extend
+        return std::max(static_cast<float>(value) / 511.0f, -1.0f);
+    };
+    Vec3 n(snorm10(packed), snorm10(packed >> 10), 0.0f);
+    n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return n.normalized();
+}
+
+// =============================================================================
+// PACK VERTICES
+// Positions relative to `box` (from quantizationBounds)
+// =============================================================================
+inline std::vector<PackedVertex> pack(std::span<const Vertex> vertices, const AABB& box) {
+    std::vector<PackedVertex> packed(vertices.size());
+    if (vertices.empty()) return packed;
+
+    Vec3 size = box.max - box.min;
+    auto unorm16 = [](float value, float min, float extent) {
+        if (extent <= 0.0f) return uint16_t{0};   // Flat along this axis
+        float t = std::clamp((value - min) / extent, 0.0f, 1.0f);
+        return static_cast<uint16_t>(std::lround(t * 65535.0f));
+    };
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+
+        out.position[0] = unorm16(vertex.position.x, box.min.x, size.x);
+        out.position[1] = unorm16(vertex.position.y, box.min.y, size.y);
+        out.position[2] = unorm16(vertex.position.z, box.min.z, size.z);
+        out.position[3] = 0;
+        out.normal = packNormal(vertex.normal);
+        out.color[0] = vertex.color.r;
+        out.color[1] = vertex.color.g;
+        out.color[2] = vertex.color.b;
+        out.color[3] = vertex.color.a;
+    }
+    return packed;
+}
+
+// =============================================================================
+// UNPACK VERTICES
+// Back to float Vertex, with `dequantize` from dequantizationMatrix (for
+// packed mesh files loaded into a Mesh; positions come back to within
+// half a quantization step)
+// =============================================================================
+inline std::vector<Vertex> unpack(std::span<const PackedVertex> packed, const Mat4& dequantize) {
+    std::vector<Vertex> vertices(packed.size());
+    for (size_t i = 0; i < packed.size(); i++) {
+        const PackedVertex& in = packed[i];
+        Vec3 unit(in.position[0] / 65535.0f, in.position[1] / 65535.0f, in.position[2] / 65535.0f);
+
+        vertices[i].position = dequantize.transformPoint(unit);
+        vertices[i].normal = unpackNormal(in.normal);
+        vertices[i].color = Color(in.color[0], in.color[1], in.color[2], in.color[3]);
+    }
+    return vertices;
+}
+
+} // namespace VertexPacking
@@ -0,0 +1,279 @@
+#pragma once
+#include "CpuFeatures.h"
+#include <cstdint>
+
+// =============================================================================
+// RasterKernels: Per-row coverage + depth test inner loops
+// =============================================================================
+// After triangle setup (Renderer3D::setupTriangle), every pixel of a row is
+// the same tiny program:
+//   1. inside = w0 >= 0 && w1 >= 0 && w2 >= 0
+//   2. if inside && z < depth[x]: depth[x] = z, color[x] = triangle color
+//   3. step w0, w1, w2, z by their per-pixel deltas
+//
+// That's a textbook SIMD loop. Each lane of a vector register handles one
+// pixel, so a single instruction advances 4 (SSE2) or 8 (AVX2) pixels:
+//
+//   lane:        0     1     2     3     4     5     6     7
+//   w0:       [w+0d][w+1d][w+2d][w+3d][w+4d][w+5d][w+6d][w+7d]
+//   inside:   [ 0  ][ 0  ][ 1  ][ 1  ][ 1  ][ 1  ][ 0  ][ 0  ]   ← lane mask
+//
+// The depth compare produces a second mask; AND them and write ONLY the
+// lanes that passed (masked store). Nothing branches per pixel.
+//
+// KERNEL SELECTION:
+// - Scalar: the reference implementation. Always available, used to validate
+//   the SIMD kernels (results match up to float rounding of the steps)
+// - SSE2:   4 pixels per iteration. Baseline on every x86-64 CPU
+// - AVX2:   8 pixels per iteration + true masked stores
+// - Auto:   best kernel the CPU we're RUNNING on supports
+//
+// RUNTIME DISPATCH:
+// The AVX2 kernel is compiled with a per-function target attribute, so the
+// binary still runs on CPUs without AVX2 - we just never call that function
+// there. This matters because Release builds with -march=native are not
+// portable, but Debug/default builds are.
+// =============================================================================
+
+#if CPU_FEATURES_X86
+    #define RASTER_KERNELS_X86 1
+    #include <immintrin.h>
+    #define RASTER_KERNELS_TARGET_AVX2 CPU_TARGET_AVX2
+#else
+    #define RASTER_KERNELS_X86 0
+#endif
+
+enum class RasterKernel {
+    Auto,
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+namespace RasterKernels {
+
+// =============================================================================
+// ROW SPAN
+// One horizontal run of pixels inside a triangle's bounding box.
+// All values are for the FIRST pixel; the d* fields are per-pixel steps.
+// =============================================================================
+struct RowSpan {
+    float* depth;            // Depth entry of the first pixel
+    uint32_t* color;         // Color entry of the first pixel (packed RGBA)
+    int count;               // Number of pixels
+    float w0, w1, w2;        // Barycentric weights at the first pixel
+    float dw0, dw1, dw2;     // Weight steps per pixel (+1 in x)
+    float z, dz;             // Depth and its step per pixel
+    uint32_t packedColor;    // Color to write (same bytes as Color)
+};
+
+using RowKernel = void (*)(const RowSpan&);
+
+// =============================================================================
+// SCALAR REFERENCE
+// Exactly the loop Renderer3D::drawTriangle3D used to run inline
+// =============================================================================
+inline void rowScalar(const RowSpan& span) {
+    float w0 = span.w0, w1 = span.w1, w2 = span.w2;
+    float z = span.z;
+
+    for (int x = 0; x < span.count; x++) {
+        if (w0 >= 0 && w1 >= 0 && w2 >= 0 && z < span.depth[x]) {
+            span.depth[x] = z;
+            span.color[x] = span.packedColor;
+        }
+        w0 += span.dw0;
+        w1 += span.dw1;
+        w2 += span.dw2;
+        z += span.dz;
+    }
+}
+
+// Finish the last (count % width) pixels of a SIMD row.
+// Re-evaluates at the first leftover pixel instead of reusing vector lanes.
+inline void rowTail(const RowSpan& span, int first) {
+    if (first >= span.count) return;
+
+    float fx = static_cast<float>(first);
+    RowSpan tail = span;
+    tail.depth += first;
+    tail.color += first;
+    tail.count -= first;
+    tail.w0 += span.dw0 * fx;
+    tail.w1 += span.dw1 * fx;
+    tail.w2 += span.dw2 * fx;
+    tail.z += span.dz * fx;
+    rowScalar(tail);
+}
+
+#if RASTER_KERNELS_X86
+
+// =============================================================================
+// SSE2: 4 PIXELS PER ITERATION
+// SSE2 has no masked store, so we blend old/new values with the mask and
+// store all 4 lanes. Safe because every lane lies inside this span, which
+// the caller owns (same tile).
+// =============================================================================
+inline void rowSSE2(const RowSpan& span) {
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 w0 = _mm_add_ps(_mm_set1_ps(span.w0), _mm_mul_ps(lane, _mm_set1_ps(span.dw0)));
+    __m128 w1 = _mm_add_ps(_mm_set1_ps(span.w1), _mm_mul_ps(lane, _mm_set1_ps(span.dw1)));
+    __m128 w2 = _mm_add_ps(_mm_set1_ps(span.w2), _mm_mul_ps(lane, _mm_set1_ps(span.dw2)));
+    __m128 z  = _mm_add_ps(_mm_set1_ps(span.z),  _mm_mul_ps(lane, _mm_set1_ps(span.dz)));
+
+    const __m128 step0 = _mm_set1_ps(span.dw0 * 4.0f);
+    const __m128 step1 = _mm_set1_ps(span.dw1 * 4.0f);
+    const __m128 step2 = _mm_set1_ps(span.dw2 * 4.0f);
+    const __m128 stepZ = _mm_set1_ps(span.dz * 4.0f);
+    const __m128i color = _mm_set1_epi32(static_cast<int>(span.packedColor));
+
+    int x = 0;
+    for (; x + 4 <= span.count; x += 4) {
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero),
+                                              _mm_cmpge_ps(w1, zero)),
+                                   _mm_cmpge_ps(w2, zero));
+
+        // Skip the memory traffic entirely for fully-outside groups
+        if (_mm_movemask_ps(inside)) {
+            float* depthPtr = span.depth + x;
+            __m128i* colorPtr = reinterpret_cast<__m128i*>(span.color + x);
+
+            __m128 oldDepth = _mm_loadu_ps(depthPtr);
+            __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, oldDepth));
+
+            if (_mm_movemask_ps(pass)) {
+                __m128i passi = _mm_castps_si128(pass);
+                __m128i oldColor = _mm_loadu_si128(colorPtr);
+
+                _mm_storeu_ps(depthPtr, _mm_or_ps(_mm_and_ps(pass, z),
+                                                  _mm_andnot_ps(pass, oldDepth)));
+                _mm_storeu_si128(colorPtr, _mm_or_si128(_mm_and_si128(passi, color),
+                                                        _mm_andnot_si128(passi, oldColor)));
+            }
+        }
+
+        w0 = _mm_add_ps(w0, step0);
+        w1 = _mm_add_ps(w1, step1);
+        w2 = _mm_add_ps(w2, step2);
+        z  = _mm_add_ps(z, stepZ);
+    }
+
+    rowTail(span, x);
+}
+
+// =============================================================================
+// AVX2: 8 PIXELS PER ITERATION
+// maskstore writes only the lanes that passed, so untouched pixels are
+// never rewritten.
+// =============================================================================
+RASTER_KERNELS_TARGET_AVX2
+inline void rowAVX2(const RowSpan& span) {
+    const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 w0 = _mm256_add_ps(_mm256_set1_ps(span.w0), _mm256_mul_ps(lane, _mm256_set1_ps(span.dw0)));
+    __m256 w1 = _mm256_add_ps(_mm256_set1_ps(span.w1), _mm256_mul_ps(lane, _mm256_set1_ps(span.dw1)));
+    __m256 w2 = _mm256_add_ps(_mm256_set1_ps(span.w2), _mm256_mul_ps(lane, _mm256_set1_ps(span.dw2)));
+    __m256 z  = _mm256_add_ps(_mm256_set1_ps(span.z),  _mm256_mul_ps(lane, _mm256_set1_ps(span.dz)));
+
+    const __m256 step0 = _mm256_set1_ps(span.dw0 * 8.0f);
+    const __m256 step1 = _mm256_set1_ps(span.dw1 * 8.0f);
+    const __m256 step2 = _mm256_set1_ps(span.dw2 * 8.0f);
+    const __m256 stepZ = _mm256_set1_ps(span.dz * 8.0f);
+    const __m256i color = _mm256_set1_epi32(static_cast<int>(span.packedColor));
+
+    int x = 0;
+    for (; x + 8 <= span.count; x += 8) {
+        __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(w0, zero, _CMP_GE_OQ),
+                                                    _mm256_cmp_ps(w1, zero, _CMP_GE_OQ)),
+                                      _mm256_cmp_ps(w2, zero, _CMP_GE_OQ));
+
+        if (_mm256_movemask_ps(inside)) {
+            float* depthPtr = span.depth + x;
+            __m256 pass = _mm256_and_ps(inside, _mm256_cmp_ps(z, _mm256_loadu_ps(depthPtr), _CMP_LT_OQ));
+
+            int bits = _mm256_movemask_ps(pass);
+            if (bits == 0xFF) {
+                // Fully covered and visible (the common case inside big
+                // triangles): plain stores are cheaper than masked ones
+                _mm256_storeu_ps(depthPtr, z);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(span.color + x), color);
+            } else if (bits) {
+                __m256i passi = _mm256_castps_si256(pass);
+                _mm256_maskstore_ps(depthPtr, passi, z);
+                _mm256_maskstore_epi32(reinterpret_cast<int*>(span.color + x), passi, color);
+            }
+        }
+
+        w0 = _mm256_add_ps(w0, step0);
+        w1 = _mm256_add_ps(w1, step1);
+        w2 = _mm256_add_ps(w2, step2);
+        z  = _mm256_add_ps(z, stepZ);
+    }
+
+    rowTail(span, x);
+}
+
+#endif  // RASTER_KERNELS_X86
+
+// =============================================================================
+// CPU FEATURE DETECTION
+// Asks the CPU itself (CPUID), not the compiler flags
+// =============================================================================
+inline bool isSupported(RasterKernel kernel) {
+    switch (kernel) {
+        case RasterKernel::Auto:
+        case RasterKernel::Scalar:
+            return true;
+#if RASTER_KERNELS_X86
+        case RasterKernel::SSE2:
+            return true;  // Part of the x86-64 baseline
+        case RasterKernel::AVX2:
+            return CpuFeatures::hasAVX2();
+#else
+        case RasterKernel::SSE2:
+        case RasterKernel::AVX2:
+            return false;
+#endif
+    }
+    return false;
+}
+
+// Best kernel for the running CPU
+inline RasterKernel detectBest() {
+    if (isSupported(RasterKernel::AVX2)) return RasterKernel::AVX2;
+    if (isSupported(RasterKernel::SSE2)) return RasterKernel::SSE2;
+    return RasterKernel::Scalar;
+}
+
+// Resolve Auto / unsupported requests to something that will actually run
+inline RasterKernel resolve(RasterKernel requested) {
+    if (requested == RasterKernel::Auto || !isSupported(requested)) {
+        return detectBest();
+    }
+    return requested;
+}
+
+inline RowKernel get(RasterKernel kernel) {
+    switch (resolve(kernel)) {
+#if RASTER_KERNELS_X86
+        case RasterKernel::AVX2: return rowAVX2;
+        case RasterKernel::SSE2: return rowSSE2;
+#endif
+        default:                 return rowScalar;
+    }
+}
+
+inline const char* name(RasterKernel kernel) {
+    switch (kernel) {
+        case RasterKernel::Auto:   return "Auto";
+        case RasterKernel::Scalar: return "Scalar";
+        case RasterKernel::SSE2:   return "SSE2";
+        case RasterKernel::AVX2:   return "AVX2";
+    }
+    return "Unknown";
+}
+
+} // namespace RasterKernels
@@ -0,0 +1,161 @@
+#pragma once
+#include "MeshHandle.h"
+#include "Mat4.h"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// =============================================================================
+// RenderQueue: Record draws now, submit them sorted later
+// =============================================================================
+// WHY DEFER?
+// Issuing each draw the moment the game asks for it means GPU state flips
+// in whatever order the scene happens to be written: program A, mesh 1,
+// program B, mesh 1, program A, mesh 2... Every switch costs driver work
+// (validation, descriptor updates), often more than the draw itself.
+//
+// Instead we RECORD draws into a flat list, then at flush time:
+// 1. Build one 64-bit SORT KEY per draw per pass
+// 2. Radix-sort the keys (stable, O(n), no comparisons)
+// 3. Replay in key order - draws sharing a program / mesh end up adjacent,
+//    so the state only changes when the key's high bits change
+//
+// SORT KEY LAYOUT (most significant first = sorted first):
+//
+//  63-62    61-60     59-44       43        42-32      31-0
+//  [pass][program][mesh slot][emissive][ unused ][command index]
+//
+// - pass:          which pass, in execution order (RendererGL decides the
+//                  numbering: cached static shadows, dynamic shadows, main)
+// - program:       which shader program (RendererGL decides the numbering)
+// - mesh slot:     small per-mesh id standing in for the VAO
+// - emissive:      the only per-draw uniform that's worth grouping
+// - command index: where the draw lives in the recorded list; also keeps
+//                  the sort deterministic (submission order within equal keys)
+//
+// Both passes replay from the SAME recorded commands - a draw is recorded
+// once and gets one key per pass it takes part in.
+// =============================================================================
+
+// =============================================================================
+// DRAW FLAGS
+// Per-draw options that affect which passes / state a draw needs
+// =============================================================================
+struct DrawFlags {
+    bool emissive = false;     // Unlit, full-bright (light sources)
+    bool castsShadow = true;   // Also rendered into the shadow map
+    bool isStatic = false;     // Transform rarely changes: its shadow can be cached
+};
+
+// =============================================================================
+// DRAW COMMAND
+// One recorded draw: a mesh plus one or more model matrices
+// (more than one = instanced draw)
+// =============================================================================
+struct DrawCommand {
+    MeshHandle mesh;           // Resolved at flush (stale handles are dropped)
+    uint32_t firstMatrix;      // Index into RenderQueue::getMatrices()
+    uint32_t instanceCount;    // 1 = regular draw
+    bool instanced;            // Recorded through submitInstanced
+    DrawFlags flags;
+};
+
+class RenderQueue {
+private:
+    std::vector<DrawCommand> commands;
+    std::vector<Mat4> matrices;    // Transforms, copied at submit time
+
+public:
+    // ==========================================================================
+    // RECORDING
+    // Transforms are copied, so callers may pass temporaries
+    // ==========================================================================
+    void submit(MeshHandle mesh, const Mat4& modelMatrix, DrawFlags flags = {}) {
+        commands.push_back({mesh, static_cast<uint32_t>(matrices.size()), 1, false, flags});
+        matrices.push_back(modelMatrix);
+    }
+
+    void submitInstanced(MeshHandle mesh, std::span<const Mat4> modelMatrices,
+                         DrawFlags flags = {}) {
+        if (modelMatrices.empty()) return;
+
+        commands.push_back({mesh, static_cast<uint32_t>(matrices.size()),
+                            static_cast<uint32_t>(modelMatrices.size()), true, flags});
+        matrices.insert(matrices.end(), modelMatrices.begin(), modelMatrices.end());
+    }
+
+    // Forget everything recorded (keeps the allocations for next frame)
+    void clear() {
+        commands.clear();
+        matrices.clear();
+    }
+
+    bool empty() const { return commands.empty(); }
+
+    const std::vector<DrawCommand>& getCommands() const { return commands; }
+
+    std::span<const Mat4> getMatrices(const DrawCommand& command) const {
+        return {matrices.data() + command.firstMatrix, command.instanceCount};
+    }
+
+    // ==========================================================================
+    // SORT KEYS
+    // ==========================================================================
+    static constexpr int PASS_BITS = 2;
+    static constexpr int PROGRAM_BITS = 2;
+    static constexpr int MESH_SLOT_BITS = 16;
+    static constexpr uint32_t MAX_MESH_SLOTS = 1u << MESH_SLOT_BITS;
+
+    static constexpr uint64_t makeKey(uint32_t pass, uint32_t program, uint32_t meshSlot,
+                                      bool emissive, uint32_t commandIndex) {
+        return (uint64_t(pass & ((1u << PASS_BITS) - 1)) << 62)
+             | (uint64_t(program & ((1u << PROGRAM_BITS) - 1)) << 60)
+             | (uint64_t(meshSlot & (MAX_MESH_SLOTS - 1)) << 44)
+             | (uint64_t(emissive ? 1 : 0) << 43)
+             | commandIndex;
+    }
+
+    static constexpr uint32_t keyPass(uint64_t key) { return uint32_t(key >> 62); }
+    static constexpr uint32_t keyCommand(uint64_t key) { return uint32_t(key); }
+
+    // ==========================================================================
+    // RADIX SORT (LSD, 8 bits per digit)
+    // Sorts keys by their upper 32 bits. The lower 32 bits (command index)
+    // are already in submission order and LSD radix sort is stable, so
+    // they never need a pass of their own.
+    //
+    // Each pass: histogram one byte → prefix sum → scatter. Bytes that are
+    // identical across all keys (unused bits, a single program, ...) are
+    // detected from the histogram and skipped.
+    //
+    // scratch is caller-owned so no allocation happens per frame.
+    // ==========================================================================
+    static void radixSort(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch) {
+        size_t count = keys.size();
+        if (count < 2) return;
+        scratch.resize(count);
+
+        for (int shift = 32; shift < 64; shift += 8) {
+            std::array<size_t, 256> offsets{};
+            for (uint64_t key : keys) {
+                offsets[(key >> shift) & 0xFF]++;
+            }
+
+            // All keys share this digit: order wouldn't change
+            if (offsets[keys[0] >> shift & 0xFF] == count) continue;
+
+            size_t sum = 0;
+            for (size_t& offset : offsets) {
+                size_t bucket = offset;
+                offset = sum;
+                sum += bucket;
+            }
+
+            for (uint64_t key : keys) {
+                scratch[offsets[(key >> shift) & 0xFF]++] = key;
+            }
+            keys.swap(scratch);
+        }
+    }
+};
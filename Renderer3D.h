@@ -5,7 +5,13 @@
 #include "Camera.h"
 #include "Mat4.h"
 #include "Vec3.h"
+#include "ThreadPool.h"
+#include "RasterKernels.h"
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
 
 // =============================================================================
 // Renderer3D: 3D rendering on top of 2D renderer
@@ -27,15 +33,163 @@
 //    - Fill triangles pixel-by-pixel with depth testing
 //
 // 5. FRAGMENT PROCESSING:
-//    - Lighting, texturing, shading (we'll do simple flat shading)
+//    - Lighting, texturing, shading (flat by default, see ShadingMode)
 //
 // This mirrors what GPUs do, but on CPU
+//
+// TWO RASTERIZATION MODES:
+// - Immediate (default): each triangle is rasterized as soon as it is set up
+// - Tiled: triangles are set up and BINNED into 64x64 screen tiles, then
+//   flush() rasterizes all tiles in parallel on a worker pool
+//
+// WHY TILES PARALLELIZE FOR FREE:
+// Two tiles never share a pixel. If each worker owns whole tiles, no two
+// threads ever write the same color/depth entry, so setPixelDepth needs no
+// locks. Inside a tile, triangles are replayed in submission order, so the
+// final image is identical to immediate mode.
 // =============================================================================
 
+// =============================================================================
+// SHADING MODES
+// =============================================================================
+// Flat:     one lit color per triangle (face normal, averaged vertex colors).
+//           Runs through the SIMD raster kernels.
+// Gouraud:  lighting evaluated per VERTEX, lit color interpolated per pixel.
+// PerPixel: vertex color and normal interpolated, lighting evaluated per
+//           PIXEL - the same math as RendererGL's fragment shader.
+//
+// PERSPECTIVE-CORRECT INTERPOLATION:
+// Screen-space barycentrics are NOT the barycentrics on the 3D triangle:
+// the far half of a receding triangle is squeezed on screen. What IS affine
+// in screen space is attribute/w and 1/w, so we interpolate those and
+// divide per pixel:
+//     attr(x, y) = (attr/w)(x, y) / (1/w)(x, y)
+// Both planes are set up once per triangle; a pixel costs one reciprocal
+// plus one multiply-add per attribute.
+// =============================================================================
+enum class ShadingMode {
+    Flat,
+    Gouraud,
+    PerPixel
+};
+
 class Renderer3D : public Renderer {
 public:
+    // Screen tile size used for binning (pixels). 64x64 = 16 KB of color +
+    // 16 KB of depth per tile, which sits comfortably in a core's L2.
+    static constexpr int BIN_TILE_SIZE = 64;
+
     explicit Renderer3D(Framebuffer& fb) : Renderer(fb) {}
 
+    // ==========================================================================
+    // TILED RASTERIZATION MODE
+    // workerCount = 0 means "one thread per hardware core"
+    //
+    // In tiled mode drawMesh only records work. Call flush() once all meshes
+    // for the frame are submitted (before presenting the framebuffer).
+    // ==========================================================================
+    void setTiledRasterization(bool enabled, unsigned workerCount = 0) {
+        flush();  // Never lose triangles binned under the old mode
+
+        tiledMode = enabled;
+        if (!enabled) {
+            pool.reset();
+            return;
+        }
+
+        if (workerCount == 0) {
+            workerCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (!pool || pool->getThreadCount() != workerCount) {
+            pool = std::make_unique<ThreadPool>(workerCount);
+        }
+    }
+
+    bool isTiledRasterization() const { return tiledMode; }
+
+    // ==========================================================================
+    // RASTER KERNEL SELECTION
+    // Picks the per-row coverage/depth loop (see RasterKernels.h).
+    // Unsupported requests fall back to the best kernel this CPU can run;
+    // getRasterKernel() reports what is actually in use.
+    // Select Scalar to validate SIMD output against the reference loop.
+    // ==========================================================================
+    void setRasterKernel(RasterKernel kernel) {
+        flush();  // Pending tiles were set up for the old kernel's caller
+        rasterKernel = RasterKernels::resolve(kernel);
+        rowKernel = RasterKernels::get(rasterKernel);
+    }
+
+    RasterKernel getRasterKernel() const { return rasterKernel; }
+
+    // ==========================================================================
+    // HIERARCHICAL Z
+    // When enabled (default), each 8x8 block of a triangle is first compared
+    // against the framebuffer's per-tile max depth; blocks that are entirely
+    // behind what's already drawn are skipped without reading a single pixel.
+    // Disable to measure the saving or to rule it out while debugging.
+    // ==========================================================================
+    void setHierarchicalZ(bool enabled) {
+        flush();
+        hierarchicalZ = enabled;
+    }
+
+    bool isHierarchicalZ() const { return hierarchicalZ; }
+
+    // ==========================================================================
+    // FRUSTUM CULLING
+    // When enabled (default), drawMesh first tests the mesh's bounding box
+    // (Mesh::bounds, moved to world space) against the camera frustum and
+    // returns before transforming a single vertex if it's fully outside.
+    // ==========================================================================
+    void setFrustumCulling(bool enabled) {
+        frustumCulling = enabled;
+    }
+
+    bool isFrustumCulling() const { return frustumCulling; }
+
+    // ==========================================================================
+    // SHADING MODE
+    // Flat is the fastest; Gouraud and PerPixel interpolate per-vertex
+    // attributes (see SHADING MODES above) and use a scalar shading loop
+    // ==========================================================================
+    void setShadingMode(ShadingMode mode) {
+        flush();
+        shadingMode = mode;
+    }
+
+    ShadingMode getShadingMode() const { return shadingMode; }
+
+    // ==========================================================================
+    // FLUSH
+    // Rasterize every binned triangle. One work item per screen tile; the
+    // pool hands tiles out dynamically, so busy tiles don't stall idle cores.
+    // No-op in immediate mode or when nothing is pending.
+    // ==========================================================================
+    void flush() {
+        if (setups.empty()) return;
+
+        pool->parallelFor(bins.size(), [this](size_t tileIndex) {
+            int tileX = static_cast<int>(tileIndex) % binCountX;
+            int tileY = static_cast<int>(tileIndex) / binCountX;
+
+            int minX = tileX * BIN_TILE_SIZE;
+            int minY = tileY * BIN_TILE_SIZE;
+            int maxX = std::min(minX + BIN_TILE_SIZE, framebuffer.getWidth()) - 1;
+            int maxY = std::min(minY + BIN_TILE_SIZE, framebuffer.getHeight()) - 1;
+
+            for (uint32_t setupIndex : bins[tileIndex]) {
+                drawTriangle3D(setups[setupIndex], minX, minY, maxX, maxY);
+            }
+        });
+
+        // Keep capacity: next frame bins roughly the same amount of work
+        for (std::vector<uint32_t>& bin : bins) {
+            bin.clear();
+        }
+        setups.clear();
+    }
+
     // ==========================================================================
     // DRAW 3D MESH
     // The main function for 3D rendering!
@@ -51,6 +205,16 @@ public:
                   Camera& camera,
                   bool wireframe = false) {
 
+        // ================================================================
+        // FRUSTUM CULLING
+        // Whole mesh outside the view: skip all of the work below
+        // (empty bounds = unknown, always drawn)
+        // ================================================================
+        if (frustumCulling && !mesh.bounds.isEmpty() &&
+            !camera.getFrustum().intersects(mesh.bounds.transformed(modelMatrix))) {
+            return;
+        }
+
         Mat4 view = camera.getViewMatrix();
         Mat4 projection = camera.getProjectionMatrix();
 
@@ -58,74 +222,37 @@ public:
         // Order matters! projection * view * model
         Mat4 mvp = projection * view * modelMatrix;
 
-        // Process each triangle
-        for (size_t i = 0; i < mesh.getTriangleCount(); i++) {
-            Vertex v0, v1, v2;
-            mesh.getTriangle(i, v0, v1, v2);
+        // Normals transform by the inverse-transpose (see Mat4::normalMatrix)
+        Mat4 normalMatrix = modelMatrix.normalMatrix();
 
-            // ================================================================
-            // VERTEX PROCESSING
-            // Transform vertices from object space → clip space
-            // ================================================================
-            Vec4 clipV0 = mvp * Vec4(v0.position, 1.0f);
-            Vec4 clipV1 = mvp * Vec4(v1.position, 1.0f);
-            Vec4 clipV2 = mvp * Vec4(v2.position, 1.0f);
+        // ================================================================
+        // VERTEX PROCESSING
+        // Transform every vertex ONCE (object space → clip → screen) into
+        // the post-transform cache; triangles below just look them up
+        // ================================================================
+        const bool smooth = shadingMode != ShadingMode::Flat && !wireframe;
+        transformVertices(mesh, normalMatrix, mvp, smooth);
+        const VertexCache& cache = vertexCache;
 
-            // ================================================================
-            // CLIPPING (SIMPLIFIED)
-            // In real renderer, we'd clip triangles against view frustum
-            // For now, just reject if all vertices out of bounds
-            // ================================================================
-            // Skip if entirely behind camera (w <= 0)
-            if (clipV0.w <= 0 && clipV1.w <= 0 && clipV2.w <= 0) continue;
-
-            // ================================================================
-            // PERSPECTIVE DIVISION
-            // Divide by w to get Normalized Device Coordinates (NDC)
-            // NDC range: [-1, 1] in all axes
-            // ================================================================
-            Vec3 ndcV0 = clipV0.toVec3();
-            Vec3 ndcV1 = clipV1.toVec3();
-            Vec3 ndcV2 = clipV2.toVec3();
-
-            // ================================================================
-            // VIEWPORT TRANSFORMATION
-            // Convert NDC [-1,1] to screen coordinates [0, width/height]
-            // Y is flipped: NDC +Y is up, screen +Y is down
-            // ================================================================
-            int width = framebuffer.getWidth();
-            int height = framebuffer.getHeight();
-
-            Vec2 screenV0(
-                (ndcV0.x + 1.0f) * 0.5f * width,
-                (1.0f - ndcV0.y) * 0.5f * height  // Flip Y
-            );
-            Vec2 screenV1(
-                (ndcV1.x + 1.0f) * 0.5f * width,
-                (1.0f - ndcV1.y) * 0.5f * height
-            );
-            Vec2 screenV2(
-                (ndcV2.x + 1.0f) * 0.5f * width,
-                (1.0f - ndcV2.y) * 0.5f * height
-            );
-
-            // Depth values (z in NDC is already normalized to [0,1])
-            float depth0 = ndcV0.z;
-            float depth1 = ndcV1.z;
-            float depth2 = ndcV2.z;
+        // Process each triangle
+        for (size_t i = 0; i < mesh.getTriangleCount(); i++) {
+            const uint32_t i0 = mesh.indices[i * 3 + 0];
+            const uint32_t i1 = mesh.indices[i * 3 + 1];
+            const uint32_t i2 = mesh.indices[i * 3 + 2];
 
             // ================================================================
-            // BACKFACE CULLING
-            // Don't draw triangles facing away from camera
-            // Check winding order: if clockwise on screen, it's facing away
+            // TRIVIAL REJECT
+            // If all three vertices are outside the SAME clip plane, no part
+            // of the triangle can be visible
             // ================================================================
-            Vec2 edge1 = screenV1 - screenV0;
-            Vec2 edge2 = screenV2 - screenV0;
-            float cross = edge1.cross(edge2);
+            uint32_t outside0 = cache.outcode[i0];
+            uint32_t outside1 = cache.outcode[i1];
+            uint32_t outside2 = cache.outcode[i2];
+            if (outside0 & outside1 & outside2) continue;
 
-            if (cross <= 0) {
-                continue;  // Back-facing, skip
-            }
+            const Vertex& v0 = mesh.vertices[i0];
+            const Vertex& v1 = mesh.vertices[i1];
+            const Vertex& v2 = mesh.vertices[i2];
 
             // ================================================================
             // LIGHTING CALCULATION
@@ -135,19 +262,15 @@ public:
             // Calculate triangle normal in object space
             Vec3 objectNormal = calculateTriangleNormal(v0.position, v1.position, v2.position);
 
-            // Transform normal to world space using model matrix
+            // Transform normal to world space using the normal matrix
             // Use transformDirection (w=0) so translation doesn't affect it
-            Vec3 worldNormal = modelMatrix.transformDirection(objectNormal).normalized();
-
-            // Light direction (world space) - coming from top-right-front
-            Vec3 lightDir = Vec3(0.3f, 0.8f, 0.5f).normalized();
+            Vec3 worldNormal = normalMatrix.transformDirection(objectNormal).normalized();
 
             // Calculate brightness using Lambertian diffuse model
             // dot(normal, light) = cos(angle) = brightness
             float diffuse = std::max(0.0f, worldNormal.dot(lightDir));
 
             // Add ambient light so nothing is completely black
-            float ambient = 0.3f;  // 30% ambient illumination
             float brightness = ambient + (1.0f - ambient) * diffuse;
 
             // Clamp to [0, 1] range
@@ -170,23 +293,627 @@ public:
             );
 
             // ================================================================
-            // RASTERIZATION
+            // CLIPPING
+            // Fast path: fully inside every plane, nothing to cut - the
+            // cached screen-space vertices are ready to rasterize
             // ================================================================
-            if (wireframe) {
-                // Draw edges only
-                drawLine(screenV0, screenV1, litColor);
-                drawLine(screenV1, screenV2, litColor);
-                drawLine(screenV2, screenV0, litColor);
-            } else {
-                // Draw filled triangle with depth testing
-                drawTriangle3D(screenV0, screenV1, screenV2,
-                               depth0, depth1, depth2,
-                               litColor);
+            if ((outside0 | outside1 | outside2) == 0) {
+                const float* varyings[3] = {cache.varyingsOf(i0), cache.varyingsOf(i1),
+                                            cache.varyingsOf(i2)};
+                rasterizeTriangle(cache.screenVertex(i0), cache.screenVertex(i1),
+                                  cache.screenVertex(i2), varyings, cache.varyingCount,
+                                  litColor, wireframe);
+                continue;
+            }
+
+            // Slow path: cut the triangle into a convex polygon that lies
+            // inside all planes, then fan it back into triangles
+            ClipVertex polygon[MAX_CLIP_VERTICES] = {cache.clipVertex(i0), cache.clipVertex(i1),
+                                                     cache.clipVertex(i2)};
+            int vertexCount = clipPolygon(polygon, 3, outside0 | outside1 | outside2,
+                                          cache.varyingCount);
+
+            for (int k = 1; k + 1 < vertexCount; k++) {
+                rasterizeClipTriangle(polygon[0], polygon[k], polygon[k + 1],
+                                      cache.varyingCount, litColor, wireframe);
             }
         }
     }
 
+    // ==========================================================================
+    // GUARD-BAND CLIPPING
+    // factor = 0 disables it (default). factor = k >= 1 clips x and y at
+    // ±k * w, i.e. k times the visible screen extent. A band lies OUTSIDE
+    // the screen by definition: factors in (0, 1) would cut visible
+    // geometry, so they are raised to 1 (negative factors mean off).
+    //
+    // The near and far planes are ALWAYS clipped - they are about
+    // correctness. The guard band is purely about keeping screen-space
+    // coordinates (and the float precision of edge functions) bounded for
+    // enormous triangles; anything between the screen and the band is
+    // handled for free by the bounding-box clamp.
+    // ==========================================================================
+    void setGuardBand(float factor) {
+        guardBand = factor <= 0.0f ? 0.0f : std::max(1.0f, factor);
+    }
+
+    float getGuardBand() const { return guardBand; }
+
 private:
+    // ==========================================================================
+    // CLIP PLANES (clip space, before the perspective divide)
+    // A vertex (x, y, z, w) is inside when:
+    //   near:  z >= -w       far:    z <= w
+    //   left:  x >= -g*w     right:  x <= g*w     (g = guard band factor)
+    //   bottom: y >= -g*w    top:    y <= g*w
+    //
+    // WHY CLIP BEFORE DIVIDING?
+    // For a vertex behind the camera w < 0, and x/w flips sign: the vertex
+    // lands on the OPPOSITE side of the screen. A triangle straddling the
+    // camera plane then produces a huge, wrong screen-space triangle. In clip
+    // space every plane is a simple linear function, so cutting there is
+    // exact and the cut points are always in front of the camera.
+    // ==========================================================================
+    enum ClipPlane : uint32_t {
+        CLIP_NEAR   = 1u << 0,
+        CLIP_FAR    = 1u << 1,
+        CLIP_LEFT   = 1u << 2,
+        CLIP_RIGHT  = 1u << 3,
+        CLIP_BOTTOM = 1u << 4,
+        CLIP_TOP    = 1u << 5,
+    };
+    static constexpr int CLIP_PLANE_COUNT = 6;
+
+    // A triangle clipped by N planes has at most 3 + N vertices
+    static constexpr int MAX_CLIP_VERTICES = 3 + CLIP_PLANE_COUNT;
+
+    float guardBand = 0.0f;  // 0 = only near/far
+
+    // ==========================================================================
+    // LIGHTING (world space, shared by every shading mode)
+    // Light comes from top-right-front; ambient keeps unlit sides visible
+    // ==========================================================================
+    const Vec3 lightDir = Vec3(0.3f, 0.8f, 0.5f).normalized();
+    const float ambient = 0.3f;
+
+    ShadingMode shadingMode = ShadingMode::Flat;
+
+    // ==========================================================================
+    // CLIP VERTEX
+    // Clip-space position plus the attributes that must be cut along with
+    // it. Varyings are stored UN-divided here; the clipper interpolates them
+    // linearly in clip space, which is exact before the divide.
+    //   Gouraud:  [r, g, b]              lit color, 0..255
+    //   PerPixel: [r, g, b, nx, ny, nz]  base color, world-space normal
+    // ==========================================================================
+    static constexpr int MAX_VARYINGS = 6;
+
+    struct ClipVertex {
+        Vec4 position;
+        float varyings[MAX_VARYINGS];
+    };
+
+    // ==========================================================================
+    // POST-TRANSFORM VERTEX CACHE
+    // ==========================================================================
+    // Mesh::getTriangle copies three Vertex structs and the old loop then
+    // multiplied each by the MVP - once per triangle that USES the vertex.
+    // In a closed mesh every vertex is shared by ~6 triangles, so ~5/6 of
+    // that work was repeated.
+    //
+    // Instead drawMesh runs one pass over mesh.vertices and stores:
+    // - clip-space position (x, y, z, w) and clipping outcode
+    // - screen-space position (x, y, depth) and 1/w, already divided and
+    //   viewport-mapped (only meaningful when the outcode is 0)
+    // - varyings (Gouraud / PerPixel)
+    // Triangles are then assembled by index. Vertex cost scales with the
+    // vertex count, not the index count.
+    //
+    // LAYOUT: positions are SoA (one array per component) so Mat4's batch
+    // kernel transforms 8 vertices per AVX instruction (object positions are
+    // gathered out of the AoS Vertex array first); varyings are AoS because
+    // the rasterizer wants all of one vertex's varyings at once.
+    // Kept as a member so the arrays keep their capacity across draws.
+    // ==========================================================================
+    struct ScreenVertex {
+        float x, y;     // Pixels
+        float depth;    // NDC z
+        float invW;     // 1 / clip w, for perspective-correct varyings
+    };
+
+    struct VertexCache {
+        std::vector<float> objectX, objectY, objectZ;
+        std::vector<float> clipX, clipY, clipZ, clipW;
+        std::vector<uint32_t> outcode;
+        std::vector<float> screenX, screenY, screenZ, invW;
+        std::vector<float> varyings;    // MAX_VARYINGS floats per vertex
+        int varyingCount = 0;           // How many of them are in use
+
+        void resize(size_t count) {
+            for (std::vector<float>* v : {&objectX, &objectY, &objectZ,
+                                          &clipX, &clipY, &clipZ, &clipW,
+                                          &screenX, &screenY, &screenZ, &invW}) {
+                v->resize(count);
+            }
+            outcode.resize(count);
+        }
+
+        ScreenVertex screenVertex(uint32_t i) const {
+            return {screenX[i], screenY[i], screenZ[i], invW[i]};
+        }
+
+        const float* varyingsOf(uint32_t i) const {
+            if (varyingCount == 0) return nullptr;
+            return varyings.data() + static_cast<size_t>(i) * MAX_VARYINGS;
+        }
+
+        ClipVertex clipVertex(uint32_t i) const {
+            ClipVertex vertex;
+            vertex.position = Vec4(clipX[i], clipY[i], clipZ[i], clipW[i]);
+            if (varyingCount > 0) {
+                std::copy_n(varyingsOf(i), varyingCount, vertex.varyings);
+            }
+            return vertex;
+        }
+    };
+
+    VertexCache vertexCache;
+
+    void transformVertices(const Mesh& mesh, const Mat4& normalMatrix, const Mat4& mvp,
+                           bool smooth) {
+        const size_t count = mesh.vertices.size();
+        VertexCache& cache = vertexCache;
+        cache.resize(count);
+
+        // AoS → SoA gather
+        for (size_t i = 0; i < count; i++) {
+            const Vec3& position = mesh.vertices[i].position;
+            cache.objectX[i] = position.x;
+            cache.objectY[i] = position.y;
+            cache.objectZ[i] = position.z;
+        }
+
+        // Clip space + fused perspective division and viewport transform.
+        // Vertices behind the camera get garbage screen values, but they
+        // always have a near-plane outcode and go through the clipper instead.
+        SoAPoints object{cache.objectX.data(), cache.objectY.data(), cache.objectZ.data()};
+        SoAClipOut clip{cache.clipX.data(), cache.clipY.data(),
+                        cache.clipZ.data(), cache.clipW.data()};
+        SoAScreenOut screen{cache.screenX.data(), cache.screenY.data(),
+                            cache.screenZ.data(), cache.invW.data(),
+                            static_cast<float>(framebuffer.getWidth()),
+                            static_cast<float>(framebuffer.getHeight())};
+        mvp.transformBatch(object, count, clip, &screen);
+
+        for (size_t i = 0; i < count; i++) {
+            cache.outcode[i] = computeOutcode(Vec4(cache.clipX[i], cache.clipY[i],
+                                                   cache.clipZ[i], cache.clipW[i]));
+        }
+
+        cache.varyingCount = 0;
+        if (smooth) {
+            cache.varyings.resize(count * MAX_VARYINGS);
+            for (size_t i = 0; i < count; i++) {
+                cache.varyingCount = computeVaryings(mesh.vertices[i], normalMatrix,
+                                                     cache.varyings.data() + i * MAX_VARYINGS);
+            }
+        }
+    }
+
+    // Fill out[] for one vertex; returns how many varyings were written
+    int computeVaryings(const Vertex& vertex, const Mat4& normalMatrix, float* out) const {
+        Vec3 normal = normalMatrix.transformDirection(vertex.normal).normalized();
+
+        if (shadingMode == ShadingMode::Gouraud) {
+            float brightness = shadeBrightness(normal);
+            out[0] = vertex.color.r * brightness;
+            out[1] = vertex.color.g * brightness;
+            out[2] = vertex.color.b * brightness;
+            return 3;
+        }
+
+        out[0] = vertex.color.r;
+        out[1] = vertex.color.g;
+        out[2] = vertex.color.b;
+        out[3] = normal.x;
+        out[4] = normal.y;
+        out[5] = normal.z;
+        return 6;
+    }
+
+    // Two-sided Lambert, as in RendererGL's fragment shader
+    float shadeBrightness(const Vec3& normal) const {
+        float facing = std::abs(normal.dot(lightDir));
+        return ambient + (1.0f - ambient) * facing;
+    }
+
+    // Signed distance to a plane; >= 0 means inside
+    float clipDistance(const Vec4& v, int plane) const {
+        switch (plane) {
+            case 0:  return v.z + v.w;                // near
+            case 1:  return v.w - v.z;                // far
+            case 2:  return v.x + guardBand * v.w;    // left
+            case 3:  return guardBand * v.w - v.x;    // right
+            case 4:  return v.y + guardBand * v.w;    // bottom
+            default: return guardBand * v.w - v.y;    // top
+        }
+    }
+
+    // Bit i set = outside plane i
+    uint32_t computeOutcode(const Vec4& v) const {
+        int planeCount = guardBand > 0.0f ? CLIP_PLANE_COUNT : 2;
+        uint32_t code = 0;
+        for (int plane = 0; plane < planeCount; plane++) {
+            if (clipDistance(v, plane) < 0.0f) code |= 1u << plane;
+        }
+        return code;
+    }
+
+    // ==========================================================================
+    // SUTHERLAND-HODGMAN POLYGON CLIPPING (1974)
+    // For each plane: walk the polygon's edges and keep
+    // - inside vertices
+    // - the intersection point of every edge that crosses the plane
+    // Only planes in planeMask (those some vertex is outside of) are visited.
+    // Returns the new vertex count (0 if everything was cut away).
+    // ==========================================================================
+    int clipPolygon(ClipVertex* polygon, int count, uint32_t planeMask,
+                    int varyingCount) const {
+        ClipVertex scratch[MAX_CLIP_VERTICES];
+        ClipVertex* in = polygon;
+        ClipVertex* out = scratch;
+
+        for (int plane = 0; plane < CLIP_PLANE_COUNT && count > 0; plane++) {
+            if (!(planeMask & (1u << plane))) continue;
+
+            int outCount = 0;
+            for (int i = 0; i < count; i++) {
+                const ClipVertex& a = in[i];
+                const ClipVertex& b = in[(i + 1) % count];
+                float da = clipDistance(a.position, plane);
+                float db = clipDistance(b.position, plane);
+
+                if (da >= 0.0f) out[outCount++] = a;
+
+                // Edge crosses the plane: add the intersection point
+                // (distances are linear in clip space, so t is exact)
+                if ((da >= 0.0f) != (db >= 0.0f)) {
+                    float t = da / (da - db);
+                    ClipVertex& cut = out[outCount++];
+                    cut.position = a.position + (b.position - a.position) * t;
+                    for (int k = 0; k < varyingCount; k++) {
+                        cut.varyings[k] = a.varyings[k] + (b.varyings[k] - a.varyings[k]) * t;
+                    }
+                }
+            }
+
+            std::swap(in, out);
+            count = outCount;
+        }
+
+        // Result may have ended up in scratch
+        if (in != polygon) {
+            std::copy(in, in + count, polygon);
+        }
+        return count;
+    }
+
+    // ==========================================================================
+    // RASTERIZE ONE CLIP-SPACE TRIANGLE
+    // All vertices are guaranteed in front of the camera (w > 0) here
+    // ==========================================================================
+    void rasterizeClipTriangle(const ClipVertex& clipV0, const ClipVertex& clipV1,
+                               const ClipVertex& clipV2, int varyingCount,
+                               const Color& color, bool wireframe) {
+        const float* varyings[3] = {clipV0.varyings, clipV1.varyings, clipV2.varyings};
+        rasterizeTriangle(toScreen(clipV0.position), toScreen(clipV1.position),
+                          toScreen(clipV2.position), varyings, varyingCount,
+                          color, wireframe);
+    }
+
+    // ================================================================
+    // PERSPECTIVE DIVISION + VIEWPORT TRANSFORMATION
+    // Divide by w to get Normalized Device Coordinates (NDC, [-1, 1]),
+    // then convert to screen coordinates [0, width/height].
+    // Y is flipped: NDC +Y is up, screen +Y is down
+    // (Same math as Mat4::transformBatch, for vertices the clipper created)
+    // ================================================================
+    ScreenVertex toScreen(const Vec4& clip) const {
+        float invW = 1.0f / clip.w;
+        return {
+            (clip.x * invW + 1.0f) * (0.5f * framebuffer.getWidth()),
+            (1.0f - clip.y * invW) * (0.5f * framebuffer.getHeight()),
+            clip.z * invW,
+            invW
+        };
+    }
+
+    // ==========================================================================
+    // RASTERIZE ONE SCREEN-SPACE TRIANGLE
+    // varyings[i] points at vertex i's varyingCount values (un-divided)
+    // ==========================================================================
+    void rasterizeTriangle(const ScreenVertex& sv0, const ScreenVertex& sv1,
+                           const ScreenVertex& sv2, const float* const varyings[3],
+                           int varyingCount, const Color& color, bool wireframe) {
+        int width = framebuffer.getWidth();
+        int height = framebuffer.getHeight();
+
+        Vec2 screenV0(sv0.x, sv0.y);
+        Vec2 screenV1(sv1.x, sv1.y);
+        Vec2 screenV2(sv2.x, sv2.y);
+
+        // ================================================================
+        // BACKFACE CULLING
+        // Don't draw triangles facing away from camera
+        // Check winding order: if clockwise on screen, it's facing away
+        // ================================================================
+        Vec2 edge1 = screenV1 - screenV0;
+        Vec2 edge2 = screenV2 - screenV0;
+        if (edge1.cross(edge2) <= 0) {
+            return;  // Back-facing, skip
+        }
+
+        // ================================================================
+        // RASTERIZATION
+        // ================================================================
+        if (wireframe) {
+            // Lines are a debug path and bypass the bins: resolve pending
+            // triangles first so draw order still matches submission order
+            flush();
+
+            // Draw edges only
+            drawLine(screenV0, screenV1, color);
+            drawLine(screenV1, screenV2, color);
+            drawLine(screenV2, screenV0, color);
+            return;
+        }
+
+        // Depth values (NDC z, in [-1, 1] after clipping)
+        TriangleSetup setup;
+        if (!setupTriangle(screenV0, screenV1, screenV2,
+                           sv0.depth, sv1.depth, sv2.depth,
+                           color, setup)) {
+            return;  // Degenerate triangle
+        }
+        if (setup.minX > setup.maxX || setup.minY > setup.maxY) {
+            return;  // Entirely off-screen
+        }
+        const ScreenVertex* vertices[3] = {&sv0, &sv1, &sv2};
+        setupVaryings(vertices, varyings, varyingCount, setup);
+
+        if (tiledMode) {
+            binTriangle(setup);
+        } else {
+            // Draw filled triangle with depth testing
+            drawTriangle3D(setup, 0, 0, width - 1, height - 1);
+        }
+    }
+
+    // ==========================================================================
+    // TRIANGLE SETUP
+    // Everything the rasterizer needs, computed once per triangle.
+    // In tiled mode these are stored and replayed by worker threads.
+    //
+    // EDGE FUNCTIONS:
+    // The barycentric weight of vertex i at pixel (x, y) is an AFFINE function
+    //     w_i(x, y) = a_i*dx + b_i*dy + c_i,   dx = x - v0.x, dy = y - v0.y
+    // (the 2D cross product against the opposite edge, divided by the area).
+    // Depth is a weighted sum of the w_i, so it is affine too:
+    //     z(x, y) = zdx*dx + zdy*dy + z0
+    //
+    // So stepping one pixel right is just "add a_i" / "add zdx" - no cross
+    // products, no division, no Vec2 temporaries in the inner loop.
+    //
+    // WHY RELATIVE TO v0?
+    // Expanding around the screen origin instead gives c_i = (p.x*q.y -
+    // p.y*q.x) / area: products of ~1e5 that cancel down to ~1, divided by a
+    // tiny area for sliver triangles. Float rounding then lets pixels far
+    // outside the triangle test as inside with garbage depth. Around v0 the
+    // constants are exactly (1, 0, 0) and depth0, and dx/dy stay small.
+    // ==========================================================================
+    struct TriangleSetup {
+        float originX, originY;         // v0: the point edge functions expand around
+        float a[3], b[3], c[3];         // Edge functions, pre-divided by area
+        float zdx, zdy, z0;             // Depth plane
+        float zMin, zMax;               // Depth range of the three vertices
+        Color color;                    // Flat-shaded color
+        int minX, minY, maxX, maxY;     // Screen bounding box (clamped)
+
+        // Perspective-correct varyings (varyingCount = 0 for flat shading)
+        // Planes of 1/w and varying/w, same form as the depth plane
+        ShadingMode shading;
+        int varyingCount;
+        float invWdx, invWdy, invW0;
+        float vdx[MAX_VARYINGS], vdy[MAX_VARYINGS], v0[MAX_VARYINGS];
+
+        float edgeAt(int i, float x, float y) const {
+            return a[i] * (x - originX) + b[i] * (y - originY) + c[i];
+        }
+
+        float depthAt(float x, float y) const {
+            return zdx * (x - originX) + zdy * (y - originY) + z0;
+        }
+
+        float invWAt(float x, float y) const {
+            return invWdx * (x - originX) + invWdy * (y - originY) + invW0;
+        }
+
+        float varyingAt(int k, float x, float y) const {
+            return vdx[k] * (x - originX) + vdy[k] * (y - originY) + v0[k];
+        }
+    };
+
+    // Coarse occlusion test against Framebuffer's per-tile max depth
+    bool hierarchicalZ = true;
+
+    // Whole-mesh bounding box test against the camera frustum
+    bool frustumCulling = true;
+
+    // Tiles never straddle bins, so tiled-mode workers never share a Hi-Z entry
+    static_assert(BIN_TILE_SIZE % Framebuffer::HIZ_TILE_SIZE == 0,
+                  "bin tiles must be made of whole Hi-Z tiles");
+
+    // Inner loop used by drawTriangle3D
+    RasterKernel rasterKernel = RasterKernels::detectBest();
+    RasterKernels::RowKernel rowKernel = RasterKernels::get(RasterKernel::Auto);
+
+    // Tiled-mode state
+    bool tiledMode = false;
+    std::unique_ptr<ThreadPool> pool;
+    std::vector<TriangleSetup> setups;          // All binned triangles this flush
+    std::vector<std::vector<uint32_t>> bins;    // Per tile: indices into setups
+    int binCountX = 0;
+    int binCountY = 0;
+
+    // Returns false for degenerate (zero-area) triangles
+    bool setupTriangle(const Vec2& v0, const Vec2& v1, const Vec2& v2,
+                       float depth0, float depth1, float depth2,
+                       const Color& color, TriangleSetup& setup) const {
+        // ONE division per triangle instead of three per pixel
+        float area = (v1 - v0).cross(v2 - v0);
+        if (std::abs(area) < 0.0001f) return false;
+        float invArea = 1.0f / area;
+
+        // w0 = cross(v1 - p, v2 - p) / area, expanded into a*dx + b*dy + c
+        // (likewise w1 for edge v2->v0 and w2 for edge v0->v1)
+        const Vec2* edgeStart[3] = {&v1, &v2, &v0};
+        const Vec2* edgeEnd[3]   = {&v2, &v0, &v1};
+        for (int i = 0; i < 3; i++) {
+            const Vec2& p = *edgeStart[i];
+            const Vec2& q = *edgeEnd[i];
+            setup.a[i] = (p.y - q.y) * invArea;
+            setup.b[i] = (q.x - p.x) * invArea;
+        }
+
+        // At v0 the barycentric weights are exactly (1, 0, 0)
+        setup.originX = v0.x;
+        setup.originY = v0.y;
+        setup.c[0] = 1.0f;
+        setup.c[1] = 0.0f;
+        setup.c[2] = 0.0f;
+
+        setup.zdx = setup.a[0] * depth0 + setup.a[1] * depth1 + setup.a[2] * depth2;
+        setup.zdy = setup.b[0] * depth0 + setup.b[1] * depth1 + setup.b[2] * depth2;
+        setup.z0  = depth0;
+        setup.zMin = std::min({depth0, depth1, depth2});
+        setup.zMax = std::max({depth0, depth1, depth2});
+        setup.color = color;
+
+        setup.minX = static_cast<int>(std::max(0.0f, std::min({v0.x, v1.x, v2.x})));
+        setup.maxX = static_cast<int>(std::min(float(framebuffer.getWidth() - 1),
+                                               std::max({v0.x, v1.x, v2.x})));
+        setup.minY = static_cast<int>(std::max(0.0f, std::min({v0.y, v1.y, v2.y})));
+        setup.maxY = static_cast<int>(std::min(float(framebuffer.getHeight() - 1),
+                                               std::max({v0.y, v1.y, v2.y})));
+        return true;
+    }
+
+    // ==========================================================================
+    // VARYING SETUP
+    // Same trick as depth: any value that is affine in screen space is
+    //     sum_i w_i * value_i
+    // so its x/y gradients are sum_i a_i * value_i and sum_i b_i * value_i.
+    // 1/w and varying/w are affine in screen space (varyings themselves are not).
+    // ==========================================================================
+    void setupVaryings(const ScreenVertex* const vertices[3], const float* const varyings[3],
+                       int varyingCount, TriangleSetup& setup) const {
+        setup.shading = shadingMode;
+        setup.varyingCount = varyingCount;
+        if (varyingCount == 0) return;
+
+        const float invW[3] = {vertices[0]->invW, vertices[1]->invW, vertices[2]->invW};
+
+        setup.invWdx = setup.a[0] * invW[0] + setup.a[1] * invW[1] + setup.a[2] * invW[2];
+        setup.invWdy = setup.b[0] * invW[0] + setup.b[1] * invW[1] + setup.b[2] * invW[2];
+        setup.invW0  = invW[0];
+
+        for (int k = 0; k < varyingCount; k++) {
+            float value[3];
+            for (int i = 0; i < 3; i++) {
+                value[i] = varyings[i][k] * invW[i];
+            }
+            setup.vdx[k] = setup.a[0] * value[0] + setup.a[1] * value[1] + setup.a[2] * value[2];
+            setup.vdy[k] = setup.b[0] * value[0] + setup.b[1] * value[1] + setup.b[2] * value[2];
+            setup.v0[k]  = value[0];
+        }
+    }
+
+    // ==========================================================================
+    // SHADED ROW (Gouraud / PerPixel)
+    // Same coverage + depth test as RasterKernels::rowScalar, but the color
+    // comes from the interpolated varyings. Every plane is stepped by its x
+    // gradient; only the 1/w reciprocal and the lighting are per pixel.
+    // ==========================================================================
+    void shadeRow(const TriangleSetup& setup, const RasterKernels::RowSpan& span,
+                  float px, float py) const {
+        float w0 = span.w0, w1 = span.w1, w2 = span.w2;
+        float z = span.z;
+        float invW = setup.invWAt(px, py);
+        float v[MAX_VARYINGS];
+        for (int k = 0; k < setup.varyingCount; k++) {
+            v[k] = setup.varyingAt(k, px, py);
+        }
+
+        for (int x = 0; x < span.count; x++) {
+            if (w0 >= 0 && w1 >= 0 && w2 >= 0 && z < span.depth[x]) {
+                float w = 1.0f / invW;
+                float r = v[0] * w;
+                float g = v[1] * w;
+                float b = v[2] * w;
+
+                if (setup.shading == ShadingMode::PerPixel) {
+                    // Interpolated normals are shorter than unit length
+                    Vec3 normal = Vec3(v[3] * w, v[4] * w, v[5] * w).normalized();
+                    float brightness = shadeBrightness(normal);
+                    r *= brightness;
+                    g *= brightness;
+                    b *= brightness;
+                }
+
+                Color color(
+                    uint8_t(std::min(255.0f, std::max(0.0f, r))),
+                    uint8_t(std::min(255.0f, std::max(0.0f, g))),
+                    uint8_t(std::min(255.0f, std::max(0.0f, b))),
+                    uint8_t(255)
+                );
+                span.depth[x] = z;
+                std::memcpy(&span.color[x], &color, sizeof(uint32_t));
+            }
+            w0 += span.dw0;
+            w1 += span.dw1;
+            w2 += span.dw2;
+            z += span.dz;
+            invW += setup.invWdx;
+            for (int k = 0; k < setup.varyingCount; k++) {
+                v[k] += setup.vdx[k];
+            }
+        }
+    }
+
+    // ==========================================================================
+    // BINNING
+    // Append the triangle to every tile its bounding box overlaps.
+    // Only indices are duplicated - the setup itself is stored once.
+    // ==========================================================================
+    void binTriangle(const TriangleSetup& setup) {
+        int countX = (framebuffer.getWidth() + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+        int countY = (framebuffer.getHeight() + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+        if (countX != binCountX || countY != binCountY) {
+            binCountX = countX;
+            binCountY = countY;
+            bins.assign(static_cast<size_t>(countX) * countY, {});
+        }
+
+        uint32_t setupIndex = static_cast<uint32_t>(setups.size());
+        setups.push_back(setup);
+
+        for (int tileY = setup.minY / BIN_TILE_SIZE; tileY <= setup.maxY / BIN_TILE_SIZE; tileY++) {
+            for (int tileX = setup.minX / BIN_TILE_SIZE; tileX <= setup.maxX / BIN_TILE_SIZE; tileX++) {
+                bins[tileY * binCountX + tileX].push_back(setupIndex);
+            }
+        }
+    }
+
     // ==========================================================================
     // CALCULATE TRIANGLE NORMAL
     // Normal = edge1 × edge2 (cross product)
@@ -198,57 +925,210 @@ private:
         return edge1.cross(edge2).normalized();
     }
 
+    // ==========================================================================
+    // BLOCK CLASSIFICATION
+    // Evaluates the triangle over a pixel rectangle using only its 4 corner
+    // pixel centers. Edge functions and depth are affine, so their extremes
+    // over the rectangle are always at a corner.
+    // ==========================================================================
+    struct BlockCoverage {
+        bool outside;       // Some edge is negative everywhere: no pixel inside
+        bool fullyInside;   // Every edge is >= 0 everywhere: every pixel inside
+        float zMin, zMax;   // Conservative depth range of the triangle here
+    };
+
+    static BlockCoverage classifyBlock(const TriangleSetup& setup,
+                                       int x0, int y0, int x1, int y1) {
+        const float cx[2] = {static_cast<float>(x0) + 0.5f, static_cast<float>(x1) + 0.5f};
+        const float cy[2] = {static_cast<float>(y0) + 0.5f, static_cast<float>(y1) + 0.5f};
+
+        BlockCoverage result{false, true, 0.0f, 0.0f};
+
+        for (int i = 0; i < 3; i++) {
+            float lo = std::numeric_limits<float>::infinity();
+            float hi = -lo;
+            for (float x : cx) {
+                for (float y : cy) {
+                    float w = setup.edgeAt(i, x, y);
+                    lo = std::min(lo, w);
+                    hi = std::max(hi, w);
+                }
+            }
+            if (hi < 0.0f) result.outside = true;
+            if (lo < 0.0f) result.fullyInside = false;
+        }
+
+        float zLo = std::numeric_limits<float>::infinity();
+        float zHi = -zLo;
+        for (float x : cx) {
+            for (float y : cy) {
+                float z = setup.depthAt(x, y);
+                zLo = std::min(zLo, z);
+                zHi = std::max(zHi, z);
+            }
+        }
+
+        // The plane extends beyond the triangle; the vertices bound the
+        // depths the triangle can actually produce
+        result.zMin = std::max(zLo, setup.zMin);
+        result.zMax = std::min(zHi, setup.zMax);
+        return result;
+    }
+
     // ==========================================================================
     // DRAW 3D TRIANGLE WITH DEPTH TESTING
     // Rasterizes triangle with proper depth interpolation
+    //
+    // Only pixels inside [clipMinX, clipMaxX] x [clipMinY, clipMaxY] are
+    // touched. Immediate mode passes the whole screen; tiled mode passes one
+    // tile, which is what makes concurrent calls on different tiles safe.
+    //
+    // HIERARCHICAL Z:
+    // The bounding box is walked in 8x8 blocks matching the framebuffer's
+    // Hi-Z tiles. A block is skipped when it is outside the triangle or when
+    // the triangle's nearest possible depth there is not closer than the
+    // farthest depth already stored in the tile. Surviving neighbours are
+    // merged into one span per row so the SIMD kernels still see long runs.
+    //
+    // Keeping Hi-Z up to date cheaply: a tile's max can only shrink when
+    // EVERY pixel in it gets a new depth. That happens exactly when the
+    // triangle fully covers the tile, and then the new max is at most the
+    // triangle's max depth there. Partial coverage leaves the stored max
+    // too large, which is still conservative (never rejects visible pixels).
     // ==========================================================================
-    void drawTriangle3D(const Vec2& v0, const Vec2& v1, const Vec2& v2,
-                        float depth0, float depth1, float depth2,
-                        const Color& color) {
+    void drawTriangle3D(const TriangleSetup& setup,
+                        int clipMinX, int clipMinY, int clipMaxX, int clipMaxY) {
+        // Bounding box restricted to the clip rectangle
+        int minX = std::max(setup.minX, clipMinX);
+        int maxX = std::min(setup.maxX, clipMaxX);
+        int minY = std::max(setup.minY, clipMinY);
+        int maxY = std::min(setup.maxY, clipMaxY);
 
-        // Get bounding box
-        int minX = static_cast<int>(std::max(0.0f, std::min({v0.x, v1.x, v2.x})));
-        int maxX = static_cast<int>(std::min(float(framebuffer.getWidth() - 1),
-                                              std::max({v0.x, v1.x, v2.x})));
-        int minY = static_cast<int>(std::max(0.0f, std::min({v0.y, v1.y, v2.y})));
-        int maxY = static_cast<int>(std::min(float(framebuffer.getHeight() - 1),
-                                              std::max({v0.y, v1.y, v2.y})));
+        if (minX > maxX || minY > maxY) return;
 
-        // Rasterize: test each pixel in bounding box
-        for (int y = minY; y <= maxY; y++) {
-            for (int x = minX; x <= maxX; x++) {
-                Vec2 p(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f);
+        // Color is written as raw 32-bit words by the kernels
+        uint32_t packedColor;
+        std::memcpy(&packedColor, &setup.color, sizeof(packedColor));
 
-                // ============================================================
-                // BARYCENTRIC COORDINATES
-                // Express point p as weighted sum of triangle vertices
-                // p = w0*v0 + w1*v1 + w2*v2 where w0+w1+w2 = 1
-                //
-                // If all weights >= 0, point is inside triangle!
-                // Weights also tell us how to interpolate depth, color, etc.
-                // ============================================================
-                float area = (v1 - v0).cross(v2 - v0);
-                if (std::abs(area) < 0.0001f) continue;  // Degenerate triangle
+        float* depthData = framebuffer.getDepthStorage();
+        uint32_t* colorData = reinterpret_cast<uint32_t*>(framebuffer.getColorStorage());
+        const int width = framebuffer.getWidth();
+        const int height = framebuffer.getHeight();
 
-                float w0 = ((v1 - p).cross(v2 - p)) / area;
-                float w1 = ((v2 - p).cross(v0 - p)) / area;
-                float w2 = ((v0 - p).cross(v1 - p)) / area;
+        // Tiled storage: a row is only contiguous within one 8x8 block
+        const bool tiledStorage = framebuffer.getLayout() == FramebufferLayout::Tiled;
 
-                // Inside triangle?
-                if (w0 >= 0 && w1 >= 0 && w2 >= 0) {
-                    // ========================================================
-                    // DEPTH INTERPOLATION
-                    // Interpolate depth using barycentric coordinates
-                    // This ensures correct depth for EVERY pixel in triangle!
-                    // ========================================================
-                    float depth = w0 * depth0 + w1 * depth1 + w2 * depth2;
+        constexpr int T = Framebuffer::HIZ_TILE_SIZE;
+        float* hiz = framebuffer.getHiZData();
+        const int hizStride = framebuffer.getHiZTileCountX();
+
+        // Is block (tileX, tileY) worth rasterizing?
+        auto blockVisible = [&](int tileX, int y0, int y1) {
+            int x0 = std::max(minX, tileX * T);
+            int x1 = std::min(maxX, tileX * T + T - 1);
+            BlockCoverage block = classifyBlock(setup, x0, y0, x1, y1);
+            if (block.outside) return false;
+            if (hierarchicalZ && block.zMin >= hiz[(y0 / T) * hizStride + tileX]) return false;
+            return true;
+        };
+
+        for (int tileY = minY / T; tileY <= maxY / T; tileY++) {
+            const int y0 = std::max(minY, tileY * T);
+            const int y1 = std::min(maxY, tileY * T + T - 1);
+
+            int tileX = minX / T;
+            const int lastTileX = maxX / T;
+
+            while (tileX <= lastTileX) {
+                // Skip rejected blocks, then grow a run of visible ones
+                if (!blockVisible(tileX, y0, y1)) {
+                    tileX++;
+                    continue;
+                }
+                int runEnd = tileX;
+                while (runEnd + 1 <= lastTileX && blockVisible(runEnd + 1, y0, y1)) {
+                    runEnd++;
+                }
+
+                const int spanMinX = std::max(minX, tileX * T);
+                const int spanMaxX = std::min(maxX, runEnd * T + T - 1);
+
+                // Fill tiles still waiting on a lazy clear before writing
+                for (int tx = tileX; tx <= runEnd; tx++) {
+                    framebuffer.resolveTile(tx, tileY);
+                }
+
+                for (int y = y0; y <= y1; y++) {
+                    const float py = static_cast<float>(y) + 0.5f;
 
                     // ========================================================
-                    // DEPTH TEST AND DRAW
-                    // Only draw if this pixel is closer than what's there
+                    // ROW SETUP
+                    // Evaluate the edge functions exactly at the first pixel
+                    // of the span (so rounding error never accumulates across
+                    // rows), then let the kernel step them along x
                     // ========================================================
-                    framebuffer.setPixelDepth(x, y, depth, color);
+                    auto drawSpan = [&](int x0, int x1) {
+                        const float px = static_cast<float>(x0) + 0.5f;
+                        const int index = framebuffer.storageIndex(x0, y);
+
+                        RasterKernels::RowSpan span;
+                        span.depth = depthData + index;
+                        span.color = colorData + index;
+                        span.count = x1 - x0 + 1;
+                        span.w0 = setup.edgeAt(0, px, py);
+                        span.w1 = setup.edgeAt(1, px, py);
+                        span.w2 = setup.edgeAt(2, px, py);
+                        span.dw0 = setup.a[0];
+                        span.dw1 = setup.a[1];
+                        span.dw2 = setup.a[2];
+                        span.z = setup.depthAt(px, py);
+                        span.dz = setup.zdx;
+                        span.packedColor = packedColor;
+
+                        // ====================================================
+                        // COVERAGE + DEPTH TEST + WRITE
+                        // Scalar, SSE2 (4 pixels) or AVX2 (8 pixels) per step
+                        // ====================================================
+                        if (setup.varyingCount == 0) {
+                            rowKernel(span);
+                        } else {
+                            shadeRow(setup, span, px, py);
+                        }
+                    };
+
+                    if (!tiledStorage) {
+                        drawSpan(spanMinX, spanMaxX);
+                    } else {
+                        // One span per block: exactly one AVX2 step each
+                        for (int tx = tileX; tx <= runEnd; tx++) {
+                            drawSpan(std::max(spanMinX, tx * T),
+                                     std::min(spanMaxX, tx * T + T - 1));
+                        }
+                    }
+                }
+
+                // ============================================================
+                // HI-Z UPDATE
+                // Only whole tiles (clipped to the screen edge) that the
+                // triangle covered completely can lower the stored max
+                // ============================================================
+                const int tileY0 = tileY * T;
+                const int tileY1 = std::min(height, tileY0 + T) - 1;
+                if (y0 == tileY0 && y1 == tileY1) {
+                    for (int tx = tileX; tx <= runEnd; tx++) {
+                        const int tileX0 = tx * T;
+                        const int tileX1 = std::min(width, tileX0 + T) - 1;
+                        if (tileX0 < minX || tileX1 > maxX) continue;
+
+                        BlockCoverage block = classifyBlock(setup, tileX0, tileY0, tileX1, tileY1);
+                        if (block.fullyInside) {
+                            float& tileMax = hiz[tileY * hizStride + tx];
+                            tileMax = std::min(tileMax, block.zMax);
+                        }
+                    }
                 }
+
+                tileX = runEnd + 1;
             }
         }
     }
@@ -2,12 +2,23 @@
 #include <GL/glew.h>  // Must be before gl.h
 #include <GL/gl.h>
 #include "Mesh.h"
+#include "Bounds.h"
 #include "Camera.h"
 #include "Mat4.h"
+#include "MeshFile.h"
+#include "MeshHandle.h"
+#include "PackedVertex.h"
 #include "Shaders.h"
+#include "RenderQueue.h"
+#include "ShadowCascades.h"
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <span>
 #include <vector>
-#include <unordered_map>
 
 // =============================================================================
 // RendererGL: OpenGL GPU-accelerated 3D renderer
@@ -33,132 +44,1092 @@ private:
     // ==========================================================================
     GLuint shaderProgram;
 
-    // Uniform locations (where to send data to shaders)
-    GLint uModelLoc;
-    GLint uViewLoc;
-    GLint uProjectionLoc;
-    GLint uLightDirLoc;
-    GLint uAmbientLoc;
-    GLint uEmissiveLoc;
-    GLint uLightSpaceMatrixLoc;  // For main shader
-    GLint uShadowMapLoc;         // Shadow map texture sampler
+    // ==========================================================================
+    // UNIFORM BUFFER OBJECTS (UBOs)
+    // ==========================================================================
+    // Camera and light state is the same for every draw in a frame, so it
+    // lives in GPU buffers filled ONCE by beginFrame instead of being
+    // re-sent with glUniform* on every draw.
+    //
+    // BINDING POINTS: a UBO is bound to a numbered slot; each program's
+    // uniform block is pointed at the same slot (glUniformBlockBinding).
+    // Every program then reads the same buffer - switching programs costs
+    // no re-upload.
+    //
+    // std140 LAYOUT: fixed, driver-independent offsets, so plain structs
+    // can mirror the GLSL blocks. Rules that matter here: mat4 = 64 bytes,
+    // vec3 is 16-aligned but a float may pack into its 4 spare bytes.
+    // ==========================================================================
+    struct FrameUniforms {        // GLSL: FrameData (Shaders.h)
+        float view[16];           // offset 0
+        float projection[16];     // offset 64
+        float cascadeMatrices[ShadowCascades::MAX_CASCADES][16];   // offset 128
+        float cascadeSplits[ShadowCascades::MAX_CASCADES];         // offset 384
+        float lightDir[3];        // offset 400
+        float ambient;            // offset 412
+        int32_t cascadeCount;     // offset 416
+        float padding[3];
+    };
+    static_assert(sizeof(FrameUniforms) == 432, "FrameUniforms must match std140 FrameData");
+
+    // One record per cascade, each at a UBO-aligned offset of shadowPassUBO;
+    // a cascade's pass binds its own record (GLSL: ShadowPassData)
+    struct ShadowPassUniforms {
+        float lightSpace[16];     // offset 0
+    };
+    static_assert(sizeof(ShadowPassUniforms) == 64, "ShadowPassUniforms must match std140 ShadowPassData");
+
+    // Per-DRAW block: lives in the stream buffer, one record per draw,
+    // selected with glBindBufferRange (GLSL: DrawData)
+    struct DrawUniforms {
+        float model[16];          // offset 0
+        float normalMatrix[12];   // offset 64: std140 mat3 = 3 columns padded to vec4
+        float emissive;           // offset 112
+        float padding[3];
+    };
+    static_assert(sizeof(DrawUniforms) == 128, "DrawUniforms must match std140 DrawData");
+
+    static constexpr GLuint FRAME_UBO_BINDING = 0;
+    static constexpr GLuint SHADOW_PASS_UBO_BINDING = 1;
+    static constexpr GLuint DRAW_UBO_BINDING = 2;
+
+    GLuint frameUBO;
+    GLuint shadowPassUBO;
+    size_t shadowPassStride;       // sizeof(ShadowPassUniforms) rounded up to the UBO offset alignment
+    std::vector<uint8_t> shadowPassStaging;   // CPU copy of shadowPassUBO (MAX_CASCADES records)
+
+    // ==========================================================================
+    // STREAMING (see StreamBuffer.h)
+    // ==========================================================================
+    // Everything that changes per draw - DrawUniforms records and instance
+    // records - is written into one triple-buffered ring. Draws point into
+    // it instead of calling glUniform* or re-uploading a buffer.
+    // ==========================================================================
+    static constexpr size_t STREAM_BYTES_PER_FRAME = 4 * 1024 * 1024;
+
+    StreamBuffer stream{STREAM_BYTES_PER_FRAME};
+    uint32_t instanceAttributeGeneration = stream.getGeneration();   // Stream the VAOs point at
+    size_t drawUniformStride;      // sizeof(DrawUniforms) rounded up to the UBO offset alignment
+    bool hasBaseInstance;          // ARB_base_instance: address instances without re-pointing attributes
 
     // ==========================================================================
-    // SHADOW MAPPING
+    // SHADOW MAPPING (cascaded, see ShadowCascades.h)
+    // ==========================================================================
+    // One depth texture ARRAY, one layer per cascade. Each layer has its
+    // own framebuffer, and the shadow pass runs once per cascade with that
+    // cascade's light matrix. The main pass picks the layer per fragment.
     // ==========================================================================
     GLuint shadowShaderProgram;    // Separate shader for shadow pass
-    GLint uShadowModelLoc;         // Model matrix for shadow shader
-    GLint uShadowLightSpaceLoc;    // Light space matrix for shadow shader
 
-    GLuint shadowMapFBO;           // Framebuffer for shadow map rendering
-    GLuint shadowMapTexture;       // Depth texture (the actual shadow map)
+    std::array<GLuint, ShadowCascades::MAX_CASCADES> shadowMapFBOs;   // One per layer
+    GLuint shadowMapTexture;       // GL_TEXTURE_2D_ARRAY of depth layers
+
+    // Per cascade. 3 cascades at 1024² hold 3/4 of the texels the old
+    // single 2048² map did, but each covers only its own slice
+    static constexpr int SHADOW_MAP_SIZE = 1024;
 
-    static constexpr int SHADOW_MAP_WIDTH = 2048;   // Shadow map resolution
-    static constexpr int SHADOW_MAP_HEIGHT = 2048;  // Higher = sharper shadows
+    ShadowCascades::Settings cascadeSettings;   // Count / split lambda (resolution = SHADOW_MAP_SIZE)
+    ShadowCascades cascades;                    // This frame's cascades (beginFrame)
+    int pendingCascadeCount = cascadeSettings.count;   // setShadowCascadeCount, applied by beginFrame
 
     // ==========================================================================
-    // MESH STORAGE
-    // Each mesh uploaded to GPU gets an ID
-    // We cache these to avoid re-uploading
+    // SHADOW CACHE (static casters)
+    // ==========================================================================
+    // Most casters (floor, walls, buildings) never move, yet a plain shadow
+    // pass redraws them into every cascade every frame. Draws submitted
+    // with DrawFlags::isStatic instead go into a second depth array that
+    // is only re-rendered when it would come out different:
+    // - the cascade's light matrix changed (light or camera moved), or
+    // - the set of static casters changed (added, removed, moved)
+    //
+    // Each frame, per cascade:
+    //   static layer ──blit──▶ shadow map layer ◀── dynamic casters drawn on top
+    //
+    // A depth blit is a plain copy - far cheaper than re-running vertex
+    // processing and rasterization for every static caster.
+    // ==========================================================================
+    struct ShadowCache {
+        GLuint texture = 0;                                          // Static depth layers
+        std::array<GLuint, ShadowCascades::MAX_CASCADES> fbos{};     // One per layer
+        std::array<Mat4, ShadowCascades::MAX_CASCADES> lightSpace;   // Matrix each layer holds
+        std::array<bool, ShadowCascades::MAX_CASCADES> valid{};
+        uint64_t casterSignature = 0;                                // Hash of the cached casters
+    };
+
+    ShadowCache shadowCache;
+    bool shadowCaching = true;
+
+    // ==========================================================================
+    // INSTANCING
+    // ==========================================================================
+    // One record per instance, written into the stream buffer before each
+    // instanced draw. Every mesh VAO points attributes 3-11 at the stream
+    // buffer with divisor 1 (see setInstanceAttributes), so any mesh can be
+    // drawn instanced. Non-instanced shaders simply don't read them.
+    // ==========================================================================
+    struct InstanceData {
+        float model[16];          // Locations 3-6  (mat4, column-major)
+        float normalMatrix[9];    // Locations 7-9  (mat3, column-major)
+        uint8_t color[4];         // Location 10    (rgb + override weight, normalized)
+        float emissive;           // Location 11    (0 or 1)
+    };
+
+    GLuint instancedShaderProgram;        // Reads only UBOs + instance attributes
+    GLuint instancedShadowShaderProgram;
+
+    // ==========================================================================
+    // MESH STORAGE (see MeshHandle.h)
+    // ==========================================================================
+    // Uploaded meshes live in a DENSE table indexed by MeshHandle::index:
+    // resolving a handle is one bounds check, one array access and one
+    // generation compare - no hashing, and nothing depends on where the
+    // CPU-side Mesh lives.
+    //
+    // Released slots go on a free list and are reused by later uploads
+    // (with a new generation), so the table stays as small as the peak
+    // number of live meshes.
     // ==========================================================================
     struct GPUMesh {
         GLuint vao;          // Vertex Array Object (state container)
         GLuint vbo;          // Vertex Buffer Object (vertex data)
         GLuint ibo;          // Index Buffer Object (triangle indices)
         GLsizei indexCount;  // Number of indices to draw
+        GLenum indexType;    // GL_UNSIGNED_SHORT when every index fits, else GL_UNSIGNED_INT
+        size_t vertexCount;  // Vertices owned (arena range size)
+        GLuint firstIndex;   // First index in the IBO (0 unless in the arena)
+        GLint baseVertex;    // Added to every index (0 unless in the arena)
+        bool inArena;        // Suballocated in the shared mesh arena
+        uint32_t sortSlot;   // Small id for RenderQueue sort keys (stands in for the VAO)
+        AABB bounds;         // Object space, from Mesh::bounds (empty = never culled)
+        VertexFormat format;   // Layout of its vertex buffer (see PackedVertex.h)
+        Mat4 dequantize;       // Packed: box 0-1 → object space, folded into model matrices
+    };
+
+    // Buffer contents for an upload: mesh.vertices / mesh.indices as-is,
+    // converted copies (same counts, same order), or a mesh file's mapping
+    struct MeshData {
+        const void* vertices;
+        size_t vertexCount;
+        VertexFormat format;
+        Mat4 dequantize;
+        const void* indices;
+        size_t indexCount;
+        GLenum indexType;
+    };
+
+    static size_t vertexStride(VertexFormat format) {
+        return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+
+    // ==========================================================================
+    // 16-BIT INDICES
+    // Most meshes have far fewer than 65536 vertices (the cube has 24), so
+    // their indices fit in uint16_t: half the index memory and half the
+    // index fetch bandwidth. Arena meshes qualify too - indices are
+    // mesh-local (baseVertex is added on the GPU), so only the mesh's own
+    // vertex count matters, not the arena's.
+    // ==========================================================================
+    static constexpr size_t MAX_SHORT_INDEX_VERTICES = 65536;
+
+    static GLenum chooseIndexType(size_t vertexCount) {
+        return vertexCount <= MAX_SHORT_INDEX_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+
+    static size_t indexSize(GLenum type) {
+        return type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    struct MeshSlot {
+        GPUMesh gpuMesh;
+        uint32_t generation = 1;   // Handles must match this (0 is never issued)
+        bool live = false;         // Holds an uploaded mesh
+    };
+
+    std::vector<MeshSlot> meshSlots;
+    std::vector<uint32_t> freeMeshSlots;   // Released slot indices, reused first
+
+    // ==========================================================================
+    // MESH ARENA (mesh batching)
+    // ==========================================================================
+    // With batching on, meshes are SUBALLOCATED into one big vertex buffer
+    // and one big index buffer behind a single VAO:
+    //
+    //   arena VBO: [ floor verts | wall verts | bar verts | ...        ]
+    //   arena IBO: [ floor idx   | wall idx   | bar idx   | ...        ]
+    //
+    // A mesh becomes (firstIndex, indexCount, baseVertex). Indices stay
+    // mesh-local; baseVertex is added by the GPU. Every arena mesh shares
+    // one VAO, so a whole pass can be submitted as ONE multi-draw.
+    //
+    // Releasing an arena mesh returns its two ranges to free lists (sorted,
+    // neighbours merged). Uploads take the first free range that fits
+    // before appending at the end, so streamed-in meshes refill the holes.
+    //
+    // A VAO has one vertex layout and a multi-draw one index type, so
+    // there is one arena per (VertexFormat, index type) pair; a pass
+    // becomes one multi-draw per arena in use.
+    // ==========================================================================
+    struct ArenaRange {
+        size_t first;    // In vertices / indices, not bytes
+        size_t count;
+    };
+
+    struct MeshArena {
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLuint ibo = 0;
+        size_t vertexCapacity = 0;
+        size_t vertexCount = 0;        // End of the used part (holes included)
+        size_t indexCapacity = 0;
+        size_t indexCount = 0;
+        std::vector<ArenaRange> freeVertices;   // Holes below vertexCount
+        std::vector<ArenaRange> freeIndices;    // Holes below indexCount
+        VertexFormat format = VertexFormat::Float;
+        GLenum indexType = GL_UNSIGNED_INT;
+    };
+
+    static constexpr size_t ARENA_INITIAL_VERTICES = 64 * 1024;
+    static constexpr size_t ARENA_INITIAL_INDICES = 3 * 64 * 1024;
+    static constexpr uint32_t ARENA_SORT_SLOTS = 4;   // Slot = arena index: one VAO each
+
+    std::array<MeshArena, ARENA_SORT_SLOTS> arenas;   // See arenaIndex
+    bool meshBatching = false;
+    VertexFormat vertexFormat = VertexFormat::Float;   // For new uploads
+    bool hasMultiDrawIndirect;   // ARB_multi_draw_indirect (GL 4.3)
+
+    // Layout glMultiDrawElementsIndirect reads (fixed by the GL spec)
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    std::vector<DrawElementsIndirectCommand> indirectCommands;   // Reused every flush
+
+    // ==========================================================================
+    // GL STATE CACHE
+    // ==========================================================================
+    // The driver does NOT skip redundant binds for us: glUseProgram with the
+    // program that's already active still costs a validation round trip.
+    // Remembering what's bound lets sorted draws skip them for free.
+    //
+    // RULE: every program / VAO / texture-unit-0 bind in this class goes
+    // through here, otherwise the cache would lie.
+    // ==========================================================================
+    struct GLStateCache {
+        GLuint program = 0;
+        GLuint vertexArray = 0;
+        GLuint texture0 = 0;     // GL_TEXTURE_2D_ARRAY on unit 0 (the only unit we use)
+
+        void useProgram(GLuint id) {
+            if (id != program) {
+                glUseProgram(id);
+                program = id;
+            }
+        }
+
+        void bindVertexArray(GLuint id) {
+            if (id != vertexArray) {
+                glBindVertexArray(id);
+                vertexArray = id;
+            }
+        }
+
+        void bindTexture0(GLuint id) {
+            if (id != texture0) {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+                texture0 = id;
+            }
+        }
     };
 
-    std::unordered_map<const Mesh*, GPUMesh> uploadedMeshes;
+    GLStateCache state;
+
+    // ==========================================================================
+    // DEFERRED DRAWS
+    // ==========================================================================
+    static constexpr uint32_t STATIC_SHADOW_PASS = 0;   // Sort-key pass field (execution order)
+    static constexpr uint32_t SHADOW_PASS = 1;
+    static constexpr uint32_t MAIN_PASS = 2;
+
+    RenderQueue queue;
+    std::vector<uint64_t> sortKeys;              // Reused every flush
+    std::vector<uint64_t> sortScratch;
+    std::vector<const GPUMesh*> commandMeshes;   // GPU mesh per recorded command (null = stale)
+    std::vector<GLintptr> commandData;           // Stream offset of each command's records
+
+    // ==========================================================================
+    // FRUSTUM CULLING
+    // ==========================================================================
+    // beginFrame extracts the planes of the camera and of every cascade's
+    // light box. Each draw's world-space box (mesh bounds through its model
+    // matrix; for instanced draws, the union over all instances) is tested
+    // against them BEFORE anything reaches GL:
+    //
+    //   flush: one bit per frustum the command touches
+    //     bit c (0-3) = shadow cascade c     bit 7 = camera
+    //
+    // A command with no bits gets no keys and no records. Shadow replays
+    // skip commands missing their cascade's bit, so a caster is only drawn
+    // into the cascades whose box it actually overlaps.
+    //
+    // Static casters are culled the same way: a cascade's cached layer is
+    // only reused while its light matrix (and so its frustum) is unchanged.
+    // ==========================================================================
+    static constexpr uint8_t CAMERA_VISIBLE = 1u << 7;
+
+    Frustum cameraFrustum;
+    std::array<Frustum, ShadowCascades::MAX_CASCADES> cascadeFrusta;
+    std::vector<uint8_t> commandVisibility;   // Frustum bits per recorded command
+    int activeCascade = 0;                    // Set by beginShadowPass (immediate mode)
+    bool frustumCulling = true;
 
 public:
+    // ==========================================================================
+    // DIRECTIONAL LIGHT
+    // Everything beginFrame needs to know about the light
+    // ==========================================================================
+    struct DirectionalLight {
+        Vec3 direction;               // Toward the light (world space, normalized)
+        float ambient = 0.3f;         // Light every surface gets, lit or not
+        float shadowDistance = 0.0f;  // View distance the cascades cover (0 = camera far plane)
+    };
+
     RendererGL() {
         compileShaders();
         compileShadowShaders();
         setupUniforms();
         setupShadowMapping();
+        setupInstancing();
+        setupUniformBuffers();
     }
 
     ~RendererGL() {
         // Clean up uploaded meshes
-        for (auto& [mesh, gpuMesh] : uploadedMeshes) {
-            glDeleteVertexArrays(1, &gpuMesh.vao);
-            glDeleteBuffers(1, &gpuMesh.vbo);
-            glDeleteBuffers(1, &gpuMesh.ibo);
+        for (MeshSlot& slot : meshSlots) {
+            if (!slot.live || slot.gpuMesh.inArena) continue;  // Arena: shared buffers, deleted below
+            glDeleteVertexArrays(1, &slot.gpuMesh.vao);
+            glDeleteBuffers(1, &slot.gpuMesh.vbo);
+            glDeleteBuffers(1, &slot.gpuMesh.ibo);
+        }
+        for (MeshArena& arena : arenas) {
+            if (arena.vao == 0) continue;
+            glDeleteVertexArrays(1, &arena.vao);
+            glDeleteBuffers(1, &arena.vbo);
+            glDeleteBuffers(1, &arena.ibo);
         }
 
         // Clean up shader programs
         glDeleteProgram(shaderProgram);
         glDeleteProgram(shadowShaderProgram);
+        glDeleteProgram(instancedShaderProgram);
+        glDeleteProgram(instancedShadowShaderProgram);
+        glDeleteBuffers(1, &frameUBO);
+        glDeleteBuffers(1, &shadowPassUBO);
 
         // Clean up shadow mapping resources
         glDeleteTextures(1, &shadowMapTexture);
-        glDeleteFramebuffers(1, &shadowMapFBO);
+        glDeleteFramebuffers(ShadowCascades::MAX_CASCADES, shadowMapFBOs.data());
+        glDeleteTextures(1, &shadowCache.texture);
+        glDeleteFramebuffers(ShadowCascades::MAX_CASCADES, shadowCache.fbos.data());
+    }
+
+    // ==========================================================================
+    // BEGIN FRAME
+    // Fit the shadow cascades to the camera and upload the per-frame and
+    // shadow-pass uniform blocks. Call once per frame, before the shadow
+    // pass; every draw until the next beginFrame uses this camera and light.
+    // ==========================================================================
+    void beginFrame(Camera& camera, const DirectionalLight& light) {
+        // New ring region for this frame's per-draw data
+        stream.nextFrame();
+
+        if (pendingCascadeCount != cascadeSettings.count) {
+            cascadeSettings.count = pendingCascadeCount;
+            allocateShadowMap();
+        }
+
+        ShadowCascades::Settings settings = cascadeSettings;
+        settings.maxDistance = light.shadowDistance;
+        cascades = ShadowCascades::compute(camera, light.direction, settings);
+
+        cameraFrustum = camera.getFrustum();
+        for (int i = 0; i < cascades.count; i++) {
+            cascadeFrusta[i] = Frustum::fromMatrix(cascades.lightSpace[i]);
+        }
+
+        FrameUniforms frame{};
+        std::memcpy(frame.view, camera.getViewMatrix().m, sizeof(frame.view));
+        std::memcpy(frame.projection, camera.getProjectionMatrix().m, sizeof(frame.projection));
+        for (int i = 0; i < cascades.count; i++) {
+            std::memcpy(frame.cascadeMatrices[i], cascades.lightSpace[i].m, sizeof(frame.cascadeMatrices[i]));
+            frame.cascadeSplits[i] = cascades.splitFar[i];
+        }
+        frame.lightDir[0] = light.direction.x;
+        frame.lightDir[1] = light.direction.y;
+        frame.lightDir[2] = light.direction.z;
+        frame.ambient = light.ambient;
+        frame.cascadeCount = cascades.count;
+        uploadUniformBuffer(frameUBO, &frame, sizeof(frame));
+
+        // All cascades' records in one upload, each at its aligned offset
+        for (int i = 0; i < cascades.count; i++) {
+            std::memcpy(shadowPassStaging.data() + i * shadowPassStride, cascades.lightSpace[i].m,
+                        sizeof(ShadowPassUniforms::lightSpace));
+        }
+        uploadUniformBuffer(shadowPassUBO, shadowPassStaging.data(),
+                            static_cast<GLsizeiptr>(shadowPassStaging.size()));
+    }
+
+    // ==========================================================================
+    // SHADOW CASCADES
+    // 2-4 is the useful range: one cascade is a plain (but camera-fitted)
+    // shadow map. DEFERRED: the shadow map array is reallocated by the next
+    // beginFrame, so a frame already begun keeps its cascades, layers and
+    // uniforms. getShadowCascadeCount reports the count in effect.
+    // ==========================================================================
+    void setShadowCascadeCount(int count) {
+        pendingCascadeCount = std::clamp(count, 1, ShadowCascades::MAX_CASCADES);
+    }
+
+    int getShadowCascadeCount() const {
+        return cascadeSettings.count;
+    }
+
+    // ==========================================================================
+    // SHADOW CACHING
+    // On: static casters (DrawFlags::isStatic) are rendered into the cached
+    // layers only when needed. Off: every caster is re-rendered every frame.
+    // ==========================================================================
+    void setShadowCaching(bool enabled) {
+        shadowCaching = enabled;
+        shadowCache.valid.fill(false);
+    }
+
+    bool getShadowCaching() const {
+        return shadowCaching;
+    }
+
+    // ==========================================================================
+    // FRUSTUM CULLING
+    // On: draws outside the camera (main pass) or a cascade's light box
+    // (shadow pass) are dropped on the CPU. Off: everything is sent to GL.
+    // ==========================================================================
+    void setFrustumCulling(bool enabled) {
+        frustumCulling = enabled;
+    }
+
+    bool getFrustumCulling() const {
+        return frustumCulling;
+    }
+
+    // ==========================================================================
+    // MESH BATCHING
+    // Meshes uploaded while enabled go into the shared mesh arena, and
+    // flush merges all arena draws of a pass into one
+    // glMultiDrawElementsIndirect call (GL 4.3). Without multi-draw
+    // indirect they're still drawn one by one, but never rebind the VAO.
+    // Meshes uploaded before enabling keep their own buffers and still work.
+    // ==========================================================================
+    void setMeshBatching(bool enabled) {
+        meshBatching = enabled;
+    }
+
+    bool getMeshBatching() const {
+        return meshBatching;
+    }
+
+    // ==========================================================================
+    // VERTEX FORMAT (see PackedVertex.h)
+    // Packed: meshes uploaded while set take 16 bytes per vertex on the GPU
+    // instead of 28 (16-bit positions within the mesh box, octahedral
+    // normals). Positions keep 1/65535 of the box size; meshes uploaded
+    // earlier keep their format. Both formats draw with the same shaders.
+    // ==========================================================================
+    void setVertexFormat(VertexFormat format) {
+        vertexFormat = format;
+    }
+
+    VertexFormat getVertexFormat() const {
+        return vertexFormat;
+    }
+
+    // ==========================================================================
+    // UPLOAD MESH TO GPU
+    // Copies the mesh into GPU memory (VRAM) and returns the handle every
+    // draw call takes. The Mesh itself isn't referenced afterwards.
+    // Uploading the same Mesh twice makes two independent GPU copies.
+    // ==========================================================================
+    MeshHandle uploadMesh(const Mesh& mesh) {
+        // Packed vertices / 16-bit indices: convert on the CPU, upload the
+        // converted copies
+        MeshData meshData{mesh.vertices.data(), mesh.vertices.size(), vertexFormat, Mat4::identity(),
+                          mesh.indices.data(), mesh.indices.size(),
+                          chooseIndexType(mesh.vertices.size())};
+        std::vector<PackedVertex> packed;
+        if (vertexFormat == VertexFormat::Packed) {
+            AABB box = VertexPacking::quantizationBounds(mesh.vertices);
+            packed = VertexPacking::pack(mesh.vertices, box);
+            meshData.vertices = packed.data();
+            meshData.dequantize = VertexPacking::dequantizationMatrix(box);
+        }
+        std::vector<uint16_t> shortIndices;
+        if (meshData.indexType == GL_UNSIGNED_SHORT) {
+            shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+            meshData.indices = shortIndices.data();
+        }
+
+        return addMesh(meshData, mesh.bounds);
+    }
+
+    // ==========================================================================
+    // UPLOAD MESH FILE (zero-copy)
+    // Uploads one LOD of a mapped mesh file (MeshFile.h). Raw streams go to
+    // glBufferData straight from the mapped pages - no parse, no staging
+    // copy; the driver's copy into VRAM is the only one. Only IndexCodec
+    // indices are decoded first. The file's vertex format is used as-is
+    // (setVertexFormat doesn't apply). The view can be closed afterwards.
+    // ==========================================================================
+    MeshHandle uploadMesh(const MeshView& view, size_t lod = 0) {
+        std::span<const uint8_t> vertices = view.getVertexData();
+        std::span<const uint8_t> indices = view.getIndexData(lod);
+        GLenum indexType = view.getIndexStorage() == MeshFile::IndexStorage::Uint16
+                               ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+        MeshData meshData{vertices.data(), view.getVertexCount(), view.getVertexFormat(),
+                          view.getDequantization(), indices.data(), view.getLod(lod).indexCount,
+                          indexType};
+
+        std::vector<uint32_t> decoded;
+        std::vector<uint16_t> shortIndices;
+        if (view.getIndexStorage() == MeshFile::IndexStorage::Compressed) {
+            decoded = view.decodeIndices(lod);
+            meshData.indices = decoded.data();
+            meshData.indexType = chooseIndexType(meshData.vertexCount);
+            if (meshData.indexType == GL_UNSIGNED_SHORT) {
+                shortIndices.assign(decoded.begin(), decoded.end());
+                meshData.indices = shortIndices.data();
+            }
+        }
+
+        return addMesh(meshData, view.getBounds());
+    }
+
+    // ==========================================================================
+    // RELEASE MESH
+    // Frees the mesh's GPU memory (or its arena ranges) right away.
+    // GL defers the actual delete until in-flight draws are done with it.
+    // Every copy of the handle becomes stale: draws with it are skipped,
+    // including ones already submitted this frame. Stale handles are ignored.
+    // ==========================================================================
+    void releaseMesh(MeshHandle handle) {
+        if (!isValid(handle)) return;
+
+        MeshSlot& slot = meshSlots[handle.index];
+        GPUMesh& gpuMesh = slot.gpuMesh;
+
+        if (gpuMesh.inArena) {
+            MeshArena& arena = arenas[arenaIndex(gpuMesh.format, gpuMesh.indexType)];
+            releaseArenaRange(arena.freeVertices, arena.vertexCount,
+                              static_cast<size_t>(gpuMesh.baseVertex), gpuMesh.vertexCount);
+            releaseArenaRange(arena.freeIndices, arena.indexCount,
+                              gpuMesh.firstIndex, static_cast<size_t>(gpuMesh.indexCount));
+        } else {
+            // Deleting the bound VAO unbinds it: keep the cache truthful
+            if (state.vertexArray == gpuMesh.vao) state.vertexArray = 0;
+            glDeleteVertexArrays(1, &gpuMesh.vao);
+            glDeleteBuffers(1, &gpuMesh.vbo);
+            glDeleteBuffers(1, &gpuMesh.ibo);
+        }
+
+        slot.live = false;
+        if (++slot.generation == 0) slot.generation = 1;  // Wrapped: 0 is never issued
+        freeMeshSlots.push_back(handle.index);
+    }
+
+    // True if handle refers to a mesh that's uploaded and not yet released
+    bool isValid(MeshHandle handle) const {
+        return handle.index < meshSlots.size()
+            && meshSlots[handle.index].generation == handle.generation
+            && meshSlots[handle.index].live;
     }
 
     // ==========================================================================
     // DRAW MESH
-    //
-    // Compare to Renderer3D::drawMesh (Renderer3D.h:31-183)
-    // - No vertex loops
-    // - No pixel loops
-    // - No manual depth testing
-    // - Just set uniforms and call draw
+    // Draw immediately. (See submit for the sorted, deferred path.)
+    // Stale handles draw nothing.
     // ==========================================================================
-    void drawMesh(const Mesh& mesh,
+    void drawMesh(MeshHandle mesh,
                   const Mat4& modelMatrix,
-                  Camera& camera,
-                  const Mat4& lightSpaceMatrix,
                   bool emissive = false) {
+        const GPUMesh* gpuMesh = resolve(mesh);
+        if (!gpuMesh || isCulled(*gpuMesh, {&modelMatrix, 1}, cameraFrustum)) return;
+
+        GLintptr drawData = streamDrawUniforms(*gpuMesh, modelMatrix, emissive);
+        drawMesh(*gpuMesh, drawData);
+    }
+
+    // ==========================================================================
+    // DRAW MESH INSTANCED
+    // Draws modelMatrices.size() copies of mesh in ONE draw call.
+    //
+    // Optional per-instance data (empty span = not used):
+    // - colors:   replaces the mesh's vertex colors for that instance
+    // - emissive: same meaning as drawMesh's emissive flag
+    // Both must be empty or the same length as modelMatrices.
+    //
+    // COST: per draw, ~108 bytes per instance written into the stream
+    // buffer and no uniforms at all - instead of a record and a draw call
+    // PER OBJECT.
+    // ==========================================================================
+    void drawMeshInstanced(MeshHandle mesh,
+                           std::span<const Mat4> modelMatrices,
+                           std::span<const Color> colors = {},
+                           std::span<const bool> emissive = {}) {
+        const GPUMesh* gpuMesh = resolve(mesh);
+        if (!gpuMesh || modelMatrices.empty()) return;
+        if (isCulled(*gpuMesh, modelMatrices, cameraFrustum)) return;
+
+        GLintptr instances = streamInstances(*gpuMesh, modelMatrices, colors, emissive, false);
+        drawMeshInstanced(*gpuMesh, instances, static_cast<GLsizei>(modelMatrices.size()));
+    }
+
+    // ==========================================================================
+    // DEFERRED SUBMISSION (see RenderQueue.h)
+    // submit* only records; flush renders the shadow pass and the main pass
+    // from the recorded list, each sorted by state, then clears it.
+    // Call beginFrame before flush.
+    // ==========================================================================
+    void submit(MeshHandle mesh, const Mat4& modelMatrix, DrawFlags flags = {}) {
+        queue.submit(mesh, modelMatrix, flags);
+    }
+
+    void submitInstanced(MeshHandle mesh, std::span<const Mat4> modelMatrices,
+                         DrawFlags flags = {}) {
+        queue.submitInstanced(mesh, modelMatrices, flags);
+    }
+
+    void flush(int screenWidth, int screenHeight) {
+        const std::vector<DrawCommand>& commands = queue.getCommands();
 
         // ======================================================================
-        // ENSURE MESH IS ON GPU
-        // Upload if this is first time seeing this mesh
+        // BUILD SORT KEYS
+        // One key per pass a command takes part in. Program field:
+        // 0 = regular, 1 = instanced (each pass has exactly one of each)
+        //
+        // With mesh batching, EVERY draw uses the instanced programs (a
+        // plain draw is one instance): per-draw data then lives in instance
+        // records, which a multi-draw can address per sub-draw through
+        // baseInstance - a uniform can't change between sub-draws.
+        // Emissive then lives in the record too, so it leaves the key.
+        //
+        // Handles released since they were submitted get no keys at all.
+        //
+        // Static casters go to the cached shadow pass (when caching is on),
+        // and are hashed so a change to them can be detected. (All of them,
+        // culled or not: the hash describes the scene, not this view.)
+        //
+        // Culled commands get no key for the passes they're invisible in.
         // ======================================================================
-        if (uploadedMeshes.find(&mesh) == uploadedMeshes.end()) {
-            uploadMesh(mesh);
+        bool batched = meshBatching;
+        uint64_t staticSignature = SIGNATURE_SEED;
+        sortKeys.clear();
+        commandMeshes.resize(commands.size());
+        commandVisibility.resize(commands.size());
+        for (uint32_t i = 0; i < commands.size(); i++) {
+            const DrawCommand& command = commands[i];
+            const GPUMesh* gpuMesh = resolve(command.mesh);
+            commandMeshes[i] = gpuMesh;
+            commandVisibility[i] = 0;
+            if (!gpuMesh) continue;
+
+            uint8_t visibility = frustumVisibility(*gpuMesh, queue.getMatrices(command),
+                                                   command.flags.castsShadow);
+            commandVisibility[i] = visibility;
+
+            uint32_t program = (command.instanced || batched) ? 1 : 0;
+            bool emissiveKey = program == 0 && command.flags.emissive;
+            if (command.flags.castsShadow) {
+                bool cached = shadowCaching && command.flags.isStatic;
+                if (cached) {
+                    staticSignature = hashCaster(staticSignature, command);
+                }
+                if (visibility & ~CAMERA_VISIBLE) {
+                    sortKeys.push_back(RenderQueue::makeKey(cached ? STATIC_SHADOW_PASS : SHADOW_PASS,
+                                                            program, gpuMesh->sortSlot, false, i));
+                }
+            }
+            if (visibility & CAMERA_VISIBLE) {
+                sortKeys.push_back(RenderQueue::makeKey(MAIN_PASS, program, gpuMesh->sortSlot,
+                                                        emissiveKey, i));
+            }
         }
 
-        const GPUMesh& gpuMesh = uploadedMeshes[&mesh];
+        RenderQueue::radixSort(sortKeys, sortScratch);
 
         // ======================================================================
-        // ACTIVATE SHADER PROGRAM
-        // All following draw calls use this shader
+        // WRITE PER-DRAW DATA (once per command, shared by both passes)
+        // Two allocations for the whole frame: one block of DrawUniforms
+        // records, one block of instance records. Commands no pass draws
+        // (culled everywhere, or stale) get none.
         // ======================================================================
-        glUseProgram(shaderProgram);
+        size_t drawCount = 0;
+        size_t instanceCount = 0;
+        for (size_t i = 0; i < commands.size(); i++) {
+            const DrawCommand& command = commands[i];
+            if (commandVisibility[i] == 0) continue;
+            if (command.instanced || batched) {
+                instanceCount += command.instanceCount;
+            } else {
+                drawCount++;
+            }
+        }
+
+        // Both blocks stay live through the replay, as do the indirect
+        // command arrays it writes (at most one command per key per
+        // replay, each array padded to a GLuint): reserve all of it so
+        // the stream can't grow underneath them
+        size_t replays = static_cast<size_t>(std::max(cascades.count, 1));
+        size_t indirectBytes = (batched && hasMultiDrawIndirect)
+            ? sortKeys.size() * replays * (sizeof(DrawElementsIndirectCommand) + sizeof(GLuint))
+            : 0;
+        stream.reserve(drawCount * drawUniformStride + drawUniformStride +
+                       instanceCount * sizeof(InstanceData) + sizeof(InstanceData) + indirectBytes);
+        repointInstanceAttributes();
+
+        StreamBuffer::Allocation drawBlock{};
+        StreamBuffer::Allocation instanceBlock{};
+        if (drawCount > 0) {
+            drawBlock = stream.allocate(drawCount * drawUniformStride, drawUniformStride);
+        }
+        if (instanceCount > 0) {
+            instanceBlock = stream.allocate(instanceCount * sizeof(InstanceData), sizeof(InstanceData));
+        }
+
+        commandData.resize(commands.size());
+        size_t drawBytes = 0;
+        size_t instanceBytes = 0;
+        for (size_t i = 0; i < commands.size(); i++) {
+            const DrawCommand& command = commands[i];
+            if (commandVisibility[i] == 0) continue;
+            std::span<const Mat4> matrices = queue.getMatrices(command);
+
+            if (command.instanced || batched) {
+                writeInstances(static_cast<uint8_t*>(instanceBlock.data) + instanceBytes,
+                               *commandMeshes[i], matrices, {}, {}, command.flags.emissive);
+                commandData[i] = instanceBlock.offset + static_cast<GLintptr>(instanceBytes);
+                instanceBytes += matrices.size() * sizeof(InstanceData);
+            } else {
+                writeDrawUniforms(static_cast<uint8_t*>(drawBlock.data) + drawBytes,
+                                  *commandMeshes[i], matrices[0], command.flags.emissive);
+                commandData[i] = drawBlock.offset + static_cast<GLintptr>(drawBytes);
+                drawBytes += drawUniformStride;
+            }
+        }
+
+        if (drawCount > 0) stream.commit(drawBlock);
+        if (instanceCount > 0) stream.commit(instanceBlock);
 
         // ======================================================================
-        // SEND UNIFORMS TO GPU
-        // These are "global variables" accessible in shaders
+        // REPLAY
+        // Keys sort by pass: static shadows, dynamic shadows, main. The
+        // shadow ranges are replayed once per cascade (same records, each
+        // cascade binds its own light matrix), the main range once.
         // ======================================================================
+        auto passBegin = [this](uint32_t pass) {
+            return std::partition_point(sortKeys.begin(), sortKeys.end(), [pass](uint64_t key) {
+                return RenderQueue::keyPass(key) < pass;
+            });
+        };
+        auto shadowBegin = passBegin(SHADOW_PASS);
+        auto mainBegin = passBegin(MAIN_PASS);
+        std::span<const uint64_t> staticShadowKeys(sortKeys.begin(), shadowBegin);
+        std::span<const uint64_t> shadowKeys(shadowBegin, mainBegin);
+        std::span<const uint64_t> mainKeys(mainBegin, sortKeys.end());
+
+        if (staticSignature != shadowCache.casterSignature) {
+            shadowCache.valid.fill(false);
+            shadowCache.casterSignature = staticSignature;
+        }
 
-        // Matrices (CPU → GPU, 16 floats each)
-        glUniformMatrix4fv(uModelLoc, 1, GL_FALSE, modelMatrix.m);
-        glUniformMatrix4fv(uViewLoc, 1, GL_FALSE, camera.getViewMatrix().m);
-        glUniformMatrix4fv(uProjectionLoc, 1, GL_FALSE, camera.getProjectionMatrix().m);
-        glUniformMatrix4fv(uLightSpaceMatrixLoc, 1, GL_FALSE, lightSpaceMatrix.m);
+        for (int cascade = 0; cascade < cascades.count; cascade++) {
+            if (staticShadowKeys.empty()) {
+                beginShadowPass(cascade);
+            } else {
+                updateShadowCache(cascade, staticShadowKeys);
+                beginCachedShadowPass(cascade);
+            }
+            replay(shadowKeys, SHADOW_PASS, static_cast<uint8_t>(1u << cascade));
+        }
+        endShadowPass(screenWidth, screenHeight);
+        replay(mainKeys, MAIN_PASS, CAMERA_VISIBLE);
 
-        // Light direction (CPU → GPU, 3 floats)
-        Vec3 lightDir = Vec3(-0.45f, 0.82f, -0.4f).normalized();
-        glUniform3f(uLightDirLoc, lightDir.x, lightDir.y, lightDir.z);
+        queue.clear();
+    }
 
-        // Ambient lighting (CPU → GPU, 1 float)
-        glUniform1f(uAmbientLoc, 0.3f);
+    // ==========================================================================
+    // SHADOW PASS: BEGIN
+    // Sets up for rendering one cascade from light's perspective (depth only).
+    // Immediate-mode callers render their casters once per cascade:
+    //   for (int c = 0; c < getShadowCascadeCount(); c++) {
+    //       beginShadowPass(c); renderShadowMesh(...); ...
+    //   }
+    //   endShadowPass(w, h);
+    // ==========================================================================
+    void beginShadowPass(int cascade = 0) {
+        activeCascade = cascade;
 
-        // Emissive flag (CPU → GPU, bool)
-        // If true, object emits light (self-illuminated, not affected by lighting)
-        glUniform1i(uEmissiveLoc, emissive ? GL_TRUE : GL_FALSE);
+        // Bind this cascade's framebuffer (render to its layer of the array)
+        bindShadowTarget(shadowMapFBOs[cascade], cascade);
 
-        // Bind shadow map texture to texture unit 0
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, shadowMapTexture);
-        glUniform1i(uShadowMapLoc, 0);  // Tell shader to use texture unit 0
+        // Clear only depth buffer (we don't have color attachment)
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        // Optional: Enable front-face culling for shadow pass
+        // This helps reduce "shadow acne" (render back faces only)
+        // Uncomment if you get self-shadowing artifacts:
+        // glCullFace(GL_FRONT);
+    }
+
+    // ==========================================================================
+    // SHADOW PASS: RENDER MESH
+    // Render mesh to shadow map (depth only, from light's POV)
+    // ==========================================================================
+    void renderShadowMesh(MeshHandle mesh,
+                          const Mat4& modelMatrix) {
+        const GPUMesh* gpuMesh = resolve(mesh);
+        if (!gpuMesh || isCulled(*gpuMesh, {&modelMatrix, 1}, cascadeFrusta[activeCascade])) return;
+
+        GLintptr drawData = streamDrawUniforms(*gpuMesh, modelMatrix, false);
+        renderShadowMesh(*gpuMesh, drawData);
+    }
+
+    // Instanced counterpart of renderShadowMesh (depth only)
+    void renderShadowMeshInstanced(MeshHandle mesh,
+                                   std::span<const Mat4> modelMatrices) {
+        const GPUMesh* gpuMesh = resolve(mesh);
+        if (!gpuMesh || modelMatrices.empty()) return;
+        if (isCulled(*gpuMesh, modelMatrices, cascadeFrusta[activeCascade])) return;
+
+        GLintptr instances = streamInstances(*gpuMesh, modelMatrices, {}, {}, false);
+        renderShadowMeshInstanced(*gpuMesh, instances,
+                                  static_cast<GLsizei>(modelMatrices.size()));
+    }
+
+    // ==========================================================================
+    // SHADOW PASS: END
+    // Restore normal rendering state
+    // ==========================================================================
+    void endShadowPass(int screenWidth, int screenHeight) {
+        // Restore default framebuffer (render to screen)
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // Restore viewport to screen size
+        glViewport(0, 0, screenWidth, screenHeight);
+
+        // Shadow maps are finished: bind the array for sampling on texture
+        // unit 0 (every lit program's uShadowMap sampler points at unit 0)
+        state.bindTexture0(shadowMapTexture);
+
+        // Restore back-face culling if we changed it
+        // glCullFace(GL_BACK);
+    }
+
+private:
+    // ==========================================================================
+    // REPLAY
+    // Issue the draws of one pass's sorted keys (flush has written every
+    // command's records). Arena draws are collected into indirect commands
+    // (each arena's sort slot keeps its draws adjacent) and submitted in
+    // one call per arena.
+    // Commands without `visibility` (the frustum bit of this pass or
+    // cascade) are skipped.
+    // ==========================================================================
+    void replay(std::span<const uint64_t> keys, uint32_t pass, uint8_t visibility) {
+        const std::vector<DrawCommand>& commands = queue.getCommands();
+        bool batched = meshBatching;
+        bool multiDraw = batched && hasMultiDrawIndirect;
+        indirectCommands.clear();
+        const MeshArena* indirectArena = nullptr;   // Arena of the collected commands
+
+        for (uint64_t key : keys) {
+            uint32_t index = RenderQueue::keyCommand(key);
+            if (!(commandVisibility[index] & visibility)) continue;
+
+            const DrawCommand& command = commands[index];
+            const GPUMesh& gpuMesh = *commandMeshes[index];
+            GLintptr data = commandData[index];
+            GLsizei instances = static_cast<GLsizei>(command.instanceCount);
+
+            if (multiDraw && gpuMesh.inArena) {
+                const MeshArena* meshArena = &arenas[arenaIndex(gpuMesh.format, gpuMesh.indexType)];
+                if (meshArena != indirectArena) {
+                    submitIndirect(pass, indirectArena);
+                    indirectArena = meshArena;
+                }
+                indirectCommands.push_back({
+                    static_cast<GLuint>(gpuMesh.indexCount),
+                    command.instanceCount,
+                    gpuMesh.firstIndex,
+                    gpuMesh.baseVertex,
+                    static_cast<GLuint>(data / static_cast<GLintptr>(sizeof(InstanceData)))
+                });
+                continue;
+            }
+
+            bool instanceRecords = command.instanced || batched;
+            if (pass != MAIN_PASS) {
+                if (instanceRecords) {
+                    renderShadowMeshInstanced(gpuMesh, data, instances);
+                } else {
+                    renderShadowMesh(gpuMesh, data);
+                }
+            } else {
+                if (instanceRecords) {
+                    drawMeshInstanced(gpuMesh, data, instances);
+                } else {
+                    drawMesh(gpuMesh, data);
+                }
+            }
+        }
+
+        submitIndirect(pass, indirectArena);
+    }
+
+    // ==========================================================================
+    // SHADOW TARGETS
+    // ==========================================================================
+    // Render into `fbo` at shadow map resolution with this cascade's light
+    // matrix (its ShadowPassData record from beginFrame)
+    void bindShadowTarget(GLuint fbo, int cascade) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+        glBindBufferRange(GL_UNIFORM_BUFFER, SHADOW_PASS_UBO_BINDING, shadowPassUBO,
+                          static_cast<GLintptr>(cascade * shadowPassStride),
+                          sizeof(ShadowPassUniforms));
+    }
+
+    // Re-render a cascade's static layer if what it holds is out of date
+    void updateShadowCache(int cascade, std::span<const uint64_t> staticKeys) {
+        const Mat4& lightSpace = cascades.lightSpace[cascade];
+        if (shadowCache.valid[cascade] &&
+            std::memcmp(shadowCache.lightSpace[cascade].m, lightSpace.m, sizeof(lightSpace.m)) == 0) {
+            return;
+        }
+
+        bindShadowTarget(shadowCache.fbos[cascade], cascade);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        replay(staticKeys, STATIC_SHADOW_PASS, static_cast<uint8_t>(1u << cascade));
+
+        shadowCache.lightSpace[cascade] = lightSpace;
+        shadowCache.valid[cascade] = true;
+    }
+
+    // Start a cascade's shadow layer from its cached static depth (instead
+    // of a clear); dynamic casters are then drawn on top
+    void beginCachedShadowPass(int cascade) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, shadowCache.fbos[cascade]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, shadowMapFBOs[cascade]);
+        glBlitFramebuffer(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE,
+                          0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE,
+                          GL_DEPTH_BUFFER_BIT, GL_NEAREST);   // Depth blits must be NEAREST
+
+        bindShadowTarget(shadowMapFBOs[cascade], cascade);
+    }
+
+    // ==========================================================================
+    // CULLING TESTS (see FRUSTUM CULLING above)
+    // ==========================================================================
+    // World box of a draw: the mesh's box moved by each instance's matrix
+    static AABB worldBounds(const GPUMesh& gpuMesh, std::span<const Mat4> matrices) {
+        AABB world;
+        for (const Mat4& matrix : matrices) {
+            world.expand(gpuMesh.bounds.transformed(matrix));
+        }
+        return world;
+    }
+
+    bool isCulled(const GPUMesh& gpuMesh, std::span<const Mat4> matrices,
+                  const Frustum& frustum) const {
+        if (!frustumCulling || gpuMesh.bounds.isEmpty()) return false;
+        return !frustum.intersects(worldBounds(gpuMesh, matrices));
+    }
+
+    // Camera bit, plus one bit per cascade for shadow casters
+    uint8_t frustumVisibility(const GPUMesh& gpuMesh, std::span<const Mat4> matrices,
+                              bool castsShadow) const {
+        uint8_t cascadeBits = static_cast<uint8_t>((1u << cascades.count) - 1);
+        if (!frustumCulling || gpuMesh.bounds.isEmpty()) {
+            return CAMERA_VISIBLE | (castsShadow ? cascadeBits : 0);
+        }
+
+        AABB world = worldBounds(gpuMesh, matrices);
+        uint8_t visibility = cameraFrustum.intersects(world) ? CAMERA_VISIBLE : 0;
+        if (castsShadow) {
+            for (int c = 0; c < cascades.count; c++) {
+                if (cascadeFrusta[c].intersects(world)) {
+                    visibility |= static_cast<uint8_t>(1u << c);
+                }
+            }
+        }
+        return visibility;
+    }
+
+    // FNV-1a over everything that decides a static caster's depth: which
+    // mesh (handle, so a re-upload counts as a change) and its transforms
+    static constexpr uint64_t SIGNATURE_SEED = 14695981039346656037ull;
+
+    uint64_t hashCaster(uint64_t hash, const DrawCommand& command) const {
+        auto mix = [&hash](const void* data, size_t bytes) {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < bytes; i++) {
+                hash = (hash ^ p[i]) * 1099511628211ull;
+            }
+        };
+        mix(&command.mesh.index, sizeof(command.mesh.index));
+        mix(&command.mesh.generation, sizeof(command.mesh.generation));
+        for (const Mat4& matrix : queue.getMatrices(command)) {
+            mix(matrix.m, sizeof(matrix.m));
+        }
+        return hash;
+    }
+
+    // ==========================================================================
+    // DRAW MESH
+    //
+    // Compare to Renderer3D::drawMesh (Renderer3D.h:31-183)
+    // - No vertex loops
+    // - No pixel loops
+    // - No manual depth testing
+    // - Just point the shader at this draw's data and call draw
+    //   (camera + light come from the UBO uploaded by beginFrame,
+    //    model matrix etc. from the DrawUniforms record at drawData)
+    // ==========================================================================
+    void drawMesh(const GPUMesh& gpuMesh, GLintptr drawData) {
+        // ======================================================================
+        // ACTIVATE SHADER PROGRAM
+        // All following draw calls use this shader
+        // (skipped by the state cache if it's already active)
+        // ======================================================================
+        state.useProgram(shaderProgram);
+
+        // ======================================================================
+        // SELECT PER-DRAW DATA
+        // Model matrix, normal matrix, emissive flag are already in the
+        // stream buffer: bind that record's byte range to the DrawData block.
+        // No data is copied here.
+        // ======================================================================
+        bindDrawUniforms(drawData);
 
         // ======================================================================
         // BIND VERTEX ARRAY
         // This sets up all vertex attribute pointers
         // (position, normal, color → shader inputs)
         // ======================================================================
-        glBindVertexArray(gpuMesh.vao);
+        state.bindVertexArray(gpuMesh.vao);
 
         // ======================================================================
         // DRAW CALL
@@ -172,91 +1143,237 @@ public:
         // 5. GPU writes to framebuffer (hardware)
         //
         // ======================================================================
-        glDrawElements(
+        glDrawElementsBaseVertex(
             GL_TRIANGLES,              // Draw triangles
             gpuMesh.indexCount,        // Number of indices
-            GL_UNSIGNED_INT,           // Index type
-            nullptr                    // Offset in IBO (0 = start)
+            gpuMesh.indexType,         // Index type (16 or 32 bit)
+            indexOffset(gpuMesh),      // Byte offset in IBO (0 unless in the arena)
+            gpuMesh.baseVertex         // Added to each index (0 unless in the arena)
         );
 
-        // Unbind (good practice, prevents accidental modifications)
-        glBindVertexArray(0);
+        // No unbind: the VAO stays bound so the next draw of the same mesh
+        // can skip the bind (everything that binds VAOs goes through state)
     }
 
-    // ==========================================================================
-    // SHADOW PASS: BEGIN
-    // Sets up for rendering from light's perspective (depth only)
-    // ==========================================================================
-    void beginShadowPass() {
-        // Bind shadow map framebuffer (render to shadow map texture)
-        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-
-        // Set viewport to shadow map resolution
-        glViewport(0, 0, SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT);
-
-        // Clear only depth buffer (we don't have color attachment)
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        // Optional: Enable front-face culling for shadow pass
-        // This helps reduce "shadow acne" (render back faces only)
-        // Uncomment if you get self-shadowing artifacts:
-        // glCullFace(GL_FRONT);
+    // Instanced draw; instance records start at byte `instances` of the stream
+    void drawMeshInstanced(const GPUMesh& gpuMesh, GLintptr instances, GLsizei instanceCount) {
+        state.useProgram(instancedShaderProgram);
+        state.bindVertexArray(gpuMesh.vao);
+        drawInstances(gpuMesh, instances, instanceCount);
     }
 
     // ==========================================================================
-    // SHADOW PASS: RENDER MESH
-    // Render mesh to shadow map (depth only, from light's POV)
+    // SHADOW DRAWS (mesh already on GPU)
     // ==========================================================================
-    void renderShadowMesh(const Mesh& mesh,
-                          const Mat4& modelMatrix,
-                          const Mat4& lightSpaceMatrix) {
-        // ======================================================================
-        // ENSURE MESH IS ON GPU
-        // ======================================================================
-        if (uploadedMeshes.find(&mesh) == uploadedMeshes.end()) {
-            uploadMesh(mesh);
-        }
-
-        const GPUMesh& gpuMesh = uploadedMeshes[&mesh];
-
+    void renderShadowMesh(const GPUMesh& gpuMesh, GLintptr drawData) {
         // ======================================================================
         // USE SHADOW SHADER
         // Simple shader that only writes depth
         // ======================================================================
-        glUseProgram(shadowShaderProgram);
+        state.useProgram(shadowShaderProgram);
 
         // ======================================================================
-        // SEND UNIFORMS
-        // Only need model matrix and light space matrix
+        // SELECT PER-DRAW DATA
+        // Only the model matrix is read - light space matrix is in the
+        // shadow-pass UBO. Same record as the main pass when replaying a queue.
         // ======================================================================
-        glUniformMatrix4fv(uShadowModelLoc, 1, GL_FALSE, modelMatrix.m);
-        glUniformMatrix4fv(uShadowLightSpaceLoc, 1, GL_FALSE, lightSpaceMatrix.m);
+        bindDrawUniforms(drawData);
 
         // ======================================================================
         // DRAW
         // GPU writes depth values to shadow map texture
         // ======================================================================
-        glBindVertexArray(gpuMesh.vao);
-        glDrawElements(GL_TRIANGLES, gpuMesh.indexCount, GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
+        state.bindVertexArray(gpuMesh.vao);
+        glDrawElementsBaseVertex(GL_TRIANGLES, gpuMesh.indexCount, gpuMesh.indexType,
+                                 indexOffset(gpuMesh), gpuMesh.baseVertex);
+    }
+
+    void renderShadowMeshInstanced(const GPUMesh& gpuMesh, GLintptr instances,
+                                   GLsizei instanceCount) {
+        state.useProgram(instancedShadowShaderProgram);
+        state.bindVertexArray(gpuMesh.vao);
+        drawInstances(gpuMesh, instances, instanceCount);
     }
 
     // ==========================================================================
-    // SHADOW PASS: END
-    // Restore normal rendering state
+    // INSTANCED DRAW FROM THE STREAM BUFFER (VAO already bound)
+    // The VAO's instance attributes must start at our records:
+    // - ARB_base_instance: they always point at byte 0 of the stream; the
+    //   draw's baseInstance skips ahead (instances / sizeof(InstanceData)
+    //   records - allocations are aligned to whole records for this)
+    // - core 3.3: re-point the attributes at the records' offset first
     // ==========================================================================
-    void endShadowPass(int screenWidth, int screenHeight) {
-        // Restore default framebuffer (render to screen)
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    void drawInstances(const GPUMesh& gpuMesh, GLintptr instances, GLsizei instanceCount) {
+        if (hasBaseInstance) {
+            GLuint baseInstance = static_cast<GLuint>(instances / static_cast<GLintptr>(sizeof(InstanceData)));
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, gpuMesh.indexCount,
+                                                          gpuMesh.indexType, indexOffset(gpuMesh),
+                                                          instanceCount, gpuMesh.baseVertex,
+                                                          baseInstance);
+        } else {
+            setInstanceAttributes(instances);
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, gpuMesh.indexCount, gpuMesh.indexType,
+                                              indexOffset(gpuMesh), instanceCount,
+                                              gpuMesh.baseVertex);
+        }
+    }
 
-        // Restore viewport to screen size
-        glViewport(0, 0, screenWidth, screenHeight);
+    static const void* indexOffset(const GPUMesh& gpuMesh) {
+        return reinterpret_cast<const void*>(static_cast<uintptr_t>(gpuMesh.firstIndex) *
+                                             indexSize(gpuMesh.indexType));
+    }
 
-        // Restore back-face culling if we changed it
-        // glCullFace(GL_BACK);
+    // ==========================================================================
+    // SUBMIT INDIRECT
+    // Draw every collected command (all in `arena`) for `pass` with ONE call.
+    // The command array is written into the stream buffer like any other
+    // per-frame data and read by the GPU from there (GL_DRAW_INDIRECT_BUFFER).
+    // ==========================================================================
+    void submitIndirect(uint32_t pass, const MeshArena* arena) {
+        if (indirectCommands.empty()) return;
+
+        size_t bytes = indirectCommands.size() * sizeof(DrawElementsIndirectCommand);
+        StreamBuffer::Allocation allocation = stream.allocate(bytes, sizeof(GLuint));
+        std::memcpy(allocation.data, indirectCommands.data(), bytes);
+        stream.commit(allocation);
+        repointInstanceAttributes();
+
+        state.useProgram(pass == MAIN_PASS ? instancedShaderProgram : instancedShadowShaderProgram);
+        state.bindVertexArray(arena->vao);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.getBuffer());
+        glMultiDrawElementsIndirect(GL_TRIANGLES, arena->indexType,
+                                    reinterpret_cast<const void*>(allocation.offset),
+                                    static_cast<GLsizei>(indirectCommands.size()),
+                                    0);  // Tightly packed
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        indirectCommands.clear();
+    }
+
+    // ==========================================================================
+    // PER-DRAW DATA → STREAM BUFFER
+    // The stream's memory is write-combined (fast to write sequentially,
+    // very slow to read): records are built on the stack, then copied in.
+    //
+    // Packed meshes get model * dequantize as their model matrix (box
+    // coordinates → world in one step), but the normal matrix of the
+    // model alone: normals aren't quantized relative to the box.
+    // ==========================================================================
+    static void writeModelMatrix(float* destination, const GPUMesh& gpuMesh, const Mat4& modelMatrix) {
+        if (gpuMesh.format == VertexFormat::Packed) {
+            Mat4 positionMatrix = modelMatrix * gpuMesh.dequantize;
+            std::memcpy(destination, positionMatrix.m, sizeof(positionMatrix.m));
+        } else {
+            std::memcpy(destination, modelMatrix.m, sizeof(modelMatrix.m));
+        }
+    }
+
+    void writeDrawUniforms(void* destination, const GPUMesh& gpuMesh,
+                           const Mat4& modelMatrix, bool emissive) {
+        DrawUniforms draw{};
+        writeModelMatrix(draw.model, gpuMesh, modelMatrix);
+
+        float normalMatrix[9];
+        modelMatrix.normalMatrix().toMat3(normalMatrix);
+        for (int column = 0; column < 3; column++) {
+            std::memcpy(&draw.normalMatrix[column * 4], &normalMatrix[column * 3], 3 * sizeof(float));
+        }
+
+        // If set, object emits light (self-illuminated, not affected by lighting)
+        draw.emissive = emissive ? 1.0f : 0.0f;
+
+        std::memcpy(destination, &draw, sizeof(draw));
+    }
+
+    // Instances without a colors / emissive entry keep their vertex colors
+    // and use defaultEmissive
+    void writeInstances(void* destination,
+                        const GPUMesh& gpuMesh,
+                        std::span<const Mat4> modelMatrices,
+                        std::span<const Color> colors,
+                        std::span<const bool> emissive,
+                        bool defaultEmissive) {
+        InstanceData* out = static_cast<InstanceData*>(destination);
+
+        for (size_t i = 0; i < modelMatrices.size(); i++) {
+            InstanceData instance;
+            const Mat4& model = modelMatrices[i];
+
+            writeModelMatrix(instance.model, gpuMesh, model);
+            model.normalMatrix().toMat3(instance.normalMatrix);
+
+            if (i < colors.size()) {
+                instance.color[0] = colors[i].r;
+                instance.color[1] = colors[i].g;
+                instance.color[2] = colors[i].b;
+                instance.color[3] = 255;  // Override weight 1: use this color
+            } else {
+                std::memset(instance.color, 0, sizeof(instance.color));
+            }
+            bool isEmissive = i < emissive.size() ? emissive[i] : defaultEmissive;
+            instance.emissive = isEmissive ? 1.0f : 0.0f;
+
+            std::memcpy(&out[i], &instance, sizeof(instance));
+        }
+    }
+
+    // One-off record for an immediate draw; returns its stream offset
+    GLintptr streamDrawUniforms(const GPUMesh& gpuMesh, const Mat4& modelMatrix, bool emissive) {
+        StreamBuffer::Allocation allocation = stream.allocate(sizeof(DrawUniforms), drawUniformStride);
+        writeDrawUniforms(allocation.data, gpuMesh, modelMatrix, emissive);
+        stream.commit(allocation);
+        return allocation.offset;
+    }
+
+    GLintptr streamInstances(const GPUMesh& gpuMesh,
+                             std::span<const Mat4> modelMatrices,
+                             std::span<const Color> colors,
+                             std::span<const bool> emissive,
+                             bool defaultEmissive) {
+        StreamBuffer::Allocation allocation =
+            stream.allocate(modelMatrices.size() * sizeof(InstanceData), sizeof(InstanceData));
+        writeInstances(allocation.data, gpuMesh, modelMatrices, colors, emissive, defaultEmissive);
+        stream.commit(allocation);
+        repointInstanceAttributes();
+        return allocation.offset;
+    }
+
+    // ==========================================================================
+    // RE-POINT INSTANCE ATTRIBUTES
+    // Every VAO's instance attributes reference the stream buffer. When the
+    // stream grows it becomes a new buffer: point them all at it again.
+    // (Call after allocating, before binding the VAO to draw.)
+    // ==========================================================================
+    void repointInstanceAttributes() {
+        if (instanceAttributeGeneration == stream.getGeneration()) return;
+
+        for (const MeshSlot& slot : meshSlots) {
+            if (slot.live && !slot.gpuMesh.inArena) {
+                state.bindVertexArray(slot.gpuMesh.vao);
+                setInstanceAttributes(0);
+            }
+        }
+        for (const MeshArena& arena : arenas) {
+            if (arena.vao != 0) {
+                state.bindVertexArray(arena.vao);
+                setInstanceAttributes(0);
+            }
+        }
+        state.bindVertexArray(0);
+        instanceAttributeGeneration = stream.getGeneration();
+    }
+
+    void bindDrawUniforms(GLintptr drawData) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_UBO_BINDING, stream.getBuffer(),
+                          drawData, sizeof(DrawUniforms));
+    }
+
+    // GPU buffers behind a handle, or nullptr if it's stale / null
+    const GPUMesh* resolve(MeshHandle handle) const {
+        return isValid(handle) ? &meshSlots[handle.index].gpuMesh : nullptr;
     }
 
-private:
     // ==========================================================================
     // COMPILE SHADERS
     // Turns GLSL source code into GPU executable
@@ -340,53 +1457,187 @@ private:
 
     // ==========================================================================
     // SETUP SHADOW MAPPING
-    // Creates framebuffer and depth texture for shadow map
+    // Creates the depth texture arrays (shadow maps + static cache) and one
+    // framebuffer per cascade layer of each
     // ==========================================================================
     void setupShadowMapping() {
+        cascadeSettings.resolution = SHADOW_MAP_SIZE;
+
+        createShadowArray(shadowMapTexture, shadowMapFBOs);
+        createShadowArray(shadowCache.texture, shadowCache.fbos);
+        allocateShadowMap();
+
+        // Layers past the current cascade count don't exist yet
+        for (int cascade = 0; cascade < cascadeSettings.count; cascade++) {
+            for (GLuint fbo : {shadowMapFBOs[cascade], shadowCache.fbos[cascade]}) {
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+                if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                    std::cerr << "ERROR: Shadow map framebuffer " << cascade
+                              << " is not complete!" << std::endl;
+                }
+            }
+        }
+
+        // Unbind framebuffer (return to default)
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void createShadowArray(GLuint& texture,
+                           std::array<GLuint, ShadowCascades::MAX_CASCADES>& fbos) {
         // ======================================================================
-        // CREATE DEPTH TEXTURE (the shadow map itself)
+        // CREATE DEPTH TEXTURE ARRAY (storage comes from allocateShadowMap)
         // ======================================================================
-        glGenTextures(1, &shadowMapTexture);
-        glBindTexture(GL_TEXTURE_2D, shadowMapTexture);
-
-        // Allocate texture storage (depth only, no color)
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-                     SHADOW_MAP_WIDTH, SHADOW_MAP_HEIGHT, 0,
-                     GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glGenTextures(1, &texture);
+        state.bindTexture0(texture);
 
         // Texture filtering (nearest = hard shadows, linear = softer)
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
         // Clamp to border (texels outside shadow map = no shadow)
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
         float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};  // White = lit (no shadow)
-        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
 
         // ======================================================================
-        // CREATE FRAMEBUFFER FOR SHADOW RENDERING
+        // CREATE ONE FRAMEBUFFER PER CASCADE
+        // Each has a single layer of the array as its depth attachment, so
+        // switching cascades is one framebuffer bind, not a re-attach
         // ======================================================================
-        glGenFramebuffers(1, &shadowMapFBO);
-        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glGenFramebuffers(ShadowCascades::MAX_CASCADES, fbos.data());
+        for (int cascade = 0; cascade < ShadowCascades::MAX_CASCADES; cascade++) {
+            glBindFramebuffer(GL_FRAMEBUFFER, fbos[cascade]);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+
+            // We don't need color output for shadow pass
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // (Re)allocate one depth layer per cascade in both arrays. Sized
+    // format: depth blits need the cache and the shadow map to match.
+    // Filtering and wrap modes are texture state and survive this.
+    void allocateShadowMap() {
+        for (GLuint texture : {shadowMapTexture, shadowCache.texture}) {
+            state.bindTexture0(texture);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24,
+                         SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, cascadeSettings.count, 0,
+                         GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        }
+        shadowCache.valid.fill(false);
 
-        // Attach depth texture to framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-                               GL_TEXTURE_2D, shadowMapTexture, 0);
+        std::cout << "Shadow maps created: " << cascadeSettings.count << " cascades x "
+                  << SHADOW_MAP_SIZE << "x" << SHADOW_MAP_SIZE << std::endl;
+    }
+
+    // ==========================================================================
+    // SETUP INSTANCING
+    // Instanced shader variants
+    // ==========================================================================
+    void setupInstancing() {
+        instancedShaderProgram = createProgram(Shaders::INSTANCED_VERTEX_SHADER,
+                                               Shaders::FRAGMENT_SHADER, "INSTANCED");
+        setShadowMapUnit(instancedShaderProgram);
 
-        // We don't need color output for shadow pass
-        glDrawBuffer(GL_NONE);
-        glReadBuffer(GL_NONE);
+        instancedShadowShaderProgram = createProgram(Shaders::INSTANCED_SHADOW_VERTEX_SHADER,
+                                                     Shaders::SHADOW_FRAGMENT_SHADER,
+                                                     "INSTANCED_SHADOW");
 
-        // Check if framebuffer is complete
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "ERROR: Shadow map framebuffer is not complete!" << std::endl;
+        hasBaseInstance = GLEW_ARB_base_instance != 0;
+        hasMultiDrawIndirect = hasBaseInstance && GLEW_ARB_multi_draw_indirect != 0;
+    }
+
+    // Compile + link a vertex/fragment pair (label is used in error output)
+    GLuint createProgram(const char* vertexSource, const char* fragmentSource,
+                         const char* label) {
+        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+        glCompileShader(vertexShader);
+        checkShaderCompilation(vertexShader, label);
+
+        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
+        glCompileShader(fragmentShader);
+        checkShaderCompilation(fragmentShader, label);
+
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+        checkProgramLinking(program);
+
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return program;
+    }
+
+    // Point a program's uShadowMap sampler at texture unit 0.
+    // Sampler uniforms are program state: set once, never per draw.
+    void setShadowMapUnit(GLuint program) {
+        state.useProgram(program);
+        glUniform1i(glGetUniformLocation(program, "uShadowMap"), 0);
+    }
+
+    // ==========================================================================
+    // SETUP UNIFORM BUFFERS
+    // Create the UBOs, attach them to their binding points, and point every
+    // program's blocks at those points. A program that doesn't declare a
+    // block simply gets GL_INVALID_INDEX and is skipped.
+    // ==========================================================================
+    void setupUniformBuffers() {
+        // DrawData ranges inside the stream buffer and ShadowPassData
+        // records must start on this boundary (commonly 256 bytes, so
+        // records are padded up to it)
+        GLint uniformAlignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+        size_t alignment = static_cast<size_t>(std::max(uniformAlignment, 1));
+        drawUniformStride = (sizeof(DrawUniforms) + alignment - 1) / alignment * alignment;
+        shadowPassStride = (sizeof(ShadowPassUniforms) + alignment - 1) / alignment * alignment;
+        shadowPassStaging.assign(shadowPassStride * ShadowCascades::MAX_CASCADES, 0);
+
+        frameUBO = createUniformBuffer(sizeof(FrameUniforms), FRAME_UBO_BINDING);
+        shadowPassUBO = createUniformBuffer(static_cast<GLsizeiptr>(shadowPassStaging.size()),
+                                            SHADOW_PASS_UBO_BINDING);
+
+        for (GLuint program : {shaderProgram, instancedShaderProgram,
+                               shadowShaderProgram, instancedShadowShaderProgram}) {
+            bindUniformBlock(program, "FrameData", FRAME_UBO_BINDING);
+            bindUniformBlock(program, "ShadowPassData", SHADOW_PASS_UBO_BINDING);
+            bindUniformBlock(program, "DrawData", DRAW_UBO_BINDING);
         }
+    }
 
-        // Unbind framebuffer (return to default)
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLuint createUniformBuffer(GLsizeiptr size, GLuint binding) {
+        GLuint ubo;
+        glGenBuffers(1, &ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-        std::cout << "Shadow map created: " << SHADOW_MAP_WIDTH << "x" << SHADOW_MAP_HEIGHT << std::endl;
+        // Stays bound to this slot for the renderer's lifetime
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+        return ubo;
+    }
+
+    // GLSL 330 has no layout(binding = N) for blocks, so bind from the CPU
+    void bindUniformBlock(GLuint program, const char* blockName, GLuint binding) {
+        GLuint blockIndex = glGetUniformBlockIndex(program, blockName);
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, blockIndex, binding);
+        }
+    }
+
+    // Orphan + refill: glBufferData(nullptr) hands the driver a fresh block
+    // of memory, so we never wait for the GPU to finish reading last frame's
+    // contents. (Once per frame - per-draw data goes through the stream.)
+    void uploadUniformBuffer(GLuint ubo, const void* data, GLsizeiptr size) {
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
     }
 
     // ==========================================================================
@@ -394,26 +1645,44 @@ private:
     // Find where to send data to shaders
     // ==========================================================================
     void setupUniforms() {
-        // Main shader uniforms
-        uModelLoc = glGetUniformLocation(shaderProgram, "uModel");
-        uViewLoc = glGetUniformLocation(shaderProgram, "uView");
-        uProjectionLoc = glGetUniformLocation(shaderProgram, "uProjection");
-        uLightDirLoc = glGetUniformLocation(shaderProgram, "uLightDir");
-        uAmbientLoc = glGetUniformLocation(shaderProgram, "uAmbient");
-        uEmissiveLoc = glGetUniformLocation(shaderProgram, "uEmissive");
-        uLightSpaceMatrixLoc = glGetUniformLocation(shaderProgram, "uLightSpaceMatrix");
-        uShadowMapLoc = glGetUniformLocation(shaderProgram, "uShadowMap");
+        // Main shader: the only plain uniform left is the sampler
+        // (everything else lives in the FrameData / DrawData blocks)
+        setShadowMapUnit(shaderProgram);
+    }
 
-        // Shadow shader uniforms
-        uShadowModelLoc = glGetUniformLocation(shadowShaderProgram, "uModel");
-        uShadowLightSpaceLoc = glGetUniformLocation(shadowShaderProgram, "uLightSpaceMatrix");
+    // ==========================================================================
+    // ADD MESH
+    // Upload the buffers (own or arena) and register the result in a slot
+    // ==========================================================================
+    MeshHandle addMesh(const MeshData& meshData, const AABB& bounds) {
+        GPUMesh gpuMesh = meshBatching ? uploadMeshToArena(meshData)
+                                       : uploadMeshBuffers(meshData);
+
+        uint32_t index;
+        if (!freeMeshSlots.empty()) {
+            index = freeMeshSlots.back();
+            freeMeshSlots.pop_back();
+        } else {
+            index = static_cast<uint32_t>(meshSlots.size());
+            meshSlots.emplace_back();
+        }
+
+        MeshSlot& slot = meshSlots[index];
+        if (!gpuMesh.inArena) {
+            gpuMesh.sortSlot = ARENA_SORT_SLOTS +
+                               index % (RenderQueue::MAX_MESH_SLOTS - ARENA_SORT_SLOTS);
+        }
+        gpuMesh.bounds = bounds;
+        slot.gpuMesh = gpuMesh;
+        slot.live = true;
+        return {index, slot.generation};
     }
 
     // ==========================================================================
-    // UPLOAD MESH TO GPU
-    // This happens ONCE per mesh (then stays in VRAM)
+    // UPLOAD MESH INTO ITS OWN BUFFERS
+    // This happens ONCE per mesh (then stays in VRAM until released)
     // ==========================================================================
-    void uploadMesh(const Mesh& mesh) {
+    GPUMesh uploadMeshBuffers(const MeshData& meshData) {
         GPUMesh gpuMesh;
 
         // ======================================================================
@@ -422,7 +1691,7 @@ private:
         // Think of it as a "state container" for vertex setup
         // ======================================================================
         glGenVertexArrays(1, &gpuMesh.vao);
-        glBindVertexArray(gpuMesh.vao);
+        state.bindVertexArray(gpuMesh.vao);
 
         // ======================================================================
         // CREATE AND FILL VERTEX BUFFER (VBO)
@@ -434,14 +1703,264 @@ private:
         // Upload data: CPU RAM → GPU VRAM
         // GL_STATIC_DRAW: data won't change (GPU can optimize)
         glBufferData(GL_ARRAY_BUFFER,
-                     mesh.vertices.size() * sizeof(Vertex),
-                     mesh.vertices.data(),
+                     meshData.vertexCount * vertexStride(meshData.format),
+                     meshData.vertices,
                      GL_STATIC_DRAW);
 
         // ======================================================================
         // CONFIGURE VERTEX ATTRIBUTES
-        // Tell GPU how to interpret vertex data
         // ======================================================================
+        setVertexAttributes(meshData.format);
+
+        // ======================================================================
+        // PER-INSTANCE ATTRIBUTES (locations 3-11, from the stream buffer)
+        // ======================================================================
+        setInstanceAttributes(0);
+
+        // ======================================================================
+        // CREATE AND FILL INDEX BUFFER (IBO / EBO)
+        // Upload triangle indices to GPU
+        // ======================================================================
+        glGenBuffers(1, &gpuMesh.ibo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.ibo);
+
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     meshData.indexCount * indexSize(meshData.indexType),
+                     meshData.indices,
+                     GL_STATIC_DRAW);
+
+        gpuMesh.indexCount = static_cast<GLsizei>(meshData.indexCount);
+        gpuMesh.indexType = meshData.indexType;
+        gpuMesh.vertexCount = meshData.vertexCount;
+        gpuMesh.firstIndex = 0;
+        gpuMesh.baseVertex = 0;
+        gpuMesh.inArena = false;
+        gpuMesh.sortSlot = 0;  // Assigned by uploadMesh
+        gpuMesh.format = meshData.format;
+        gpuMesh.dequantize = meshData.dequantize;
+
+        // Unbind
+        state.bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        std::cout << "Uploaded mesh: " << meshData.vertexCount << " vertices, "
+                  << meshData.indexCount / 3 << " triangles" << std::endl;
+        return gpuMesh;
+    }
+
+    // ==========================================================================
+    // UPLOAD MESH TO THE ARENA
+    // Copy the mesh's vertices and indices into free ranges of the shared
+    // buffers (reusing released holes first, growing if needed) and
+    // remember where they landed.
+    // ==========================================================================
+    GPUMesh uploadMeshToArena(const MeshData& meshData) {
+        uint32_t arenaSlot = arenaIndex(meshData.format, meshData.indexType);
+        MeshArena& arena = arenas[arenaSlot];
+        if (arena.vao == 0) {
+            createArena(arena, meshData.format, meshData.indexType);
+        }
+
+        size_t stride = vertexStride(arena.format);
+        size_t bytesPerIndex = indexSize(arena.indexType);
+        size_t firstVertex = takeArenaRange(arena.freeVertices, meshData.vertexCount);
+        size_t firstIndex = takeArenaRange(arena.freeIndices, meshData.indexCount);
+        reserveArena(arena,
+                     arena.vertexCount + (firstVertex == NO_RANGE ? meshData.vertexCount : 0),
+                     arena.indexCount + (firstIndex == NO_RANGE ? meshData.indexCount : 0));
+        if (firstVertex == NO_RANGE) {
+            firstVertex = arena.vertexCount;
+            arena.vertexCount += meshData.vertexCount;
+        }
+        if (firstIndex == NO_RANGE) {
+            firstIndex = arena.indexCount;
+            arena.indexCount += meshData.indexCount;
+        }
+
+        // Plain buffer updates. A reused hole may still be read by frames
+        // in flight from before its release; the driver orders the update
+        // after them.
+        glBindBuffer(GL_COPY_WRITE_BUFFER, arena.vbo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER,
+                        static_cast<GLintptr>(firstVertex * stride),
+                        static_cast<GLsizeiptr>(meshData.vertexCount * stride),
+                        meshData.vertices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, arena.ibo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER,
+                        static_cast<GLintptr>(firstIndex * bytesPerIndex),
+                        static_cast<GLsizeiptr>(meshData.indexCount * bytesPerIndex),
+                        meshData.indices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        GPUMesh gpuMesh;
+        gpuMesh.vao = arena.vao;
+        gpuMesh.vbo = 0;
+        gpuMesh.ibo = 0;
+        gpuMesh.indexCount = static_cast<GLsizei>(meshData.indexCount);
+        gpuMesh.indexType = arena.indexType;
+        gpuMesh.vertexCount = meshData.vertexCount;
+        gpuMesh.firstIndex = static_cast<GLuint>(firstIndex);
+        gpuMesh.baseVertex = static_cast<GLint>(firstVertex);
+        gpuMesh.inArena = true;
+        gpuMesh.sortSlot = arenaSlot;
+        gpuMesh.format = arena.format;
+        gpuMesh.dequantize = meshData.dequantize;
+
+        std::cout << "Uploaded mesh to arena: " << meshData.vertexCount << " vertices, "
+                  << meshData.indexCount / 3 << " triangles (arena: " << arena.vertexCount
+                  << " vertices)" << std::endl;
+        return gpuMesh;
+    }
+
+    // ==========================================================================
+    // ARENA FREE LISTS
+    // Each list holds the holes below the arena's end, sorted by position
+    // with touching neighbours merged. A hole that reaches the end is
+    // given back to the end instead, so releasing the most recent uploads
+    // shrinks the arena's used part again.
+    // ==========================================================================
+    static constexpr size_t NO_RANGE = static_cast<size_t>(-1);
+
+    // First fit: start of a free range of `count` elements, or NO_RANGE
+    static size_t takeArenaRange(std::vector<ArenaRange>& freeList, size_t count) {
+        for (size_t i = 0; i < freeList.size(); i++) {
+            ArenaRange& range = freeList[i];
+            if (range.count < count) continue;
+
+            size_t first = range.first;
+            range.first += count;
+            range.count -= count;
+            if (range.count == 0) {
+                freeList.erase(freeList.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+            return first;
+        }
+        return NO_RANGE;
+    }
+
+    static void releaseArenaRange(std::vector<ArenaRange>& freeList, size_t& used,
+                                  size_t first, size_t count) {
+        if (count == 0) return;
+
+        auto next = std::lower_bound(freeList.begin(), freeList.end(), first,
+                                     [](const ArenaRange& range, size_t value) {
+                                         return range.first < value;
+                                     });
+        auto it = freeList.insert(next, {first, count});
+
+        // Merge with the following hole, then with the preceding one
+        auto following = it + 1;
+        if (following != freeList.end() && it->first + it->count == following->first) {
+            it->count += following->count;
+            freeList.erase(following);
+        }
+        if (it != freeList.begin()) {
+            auto preceding = it - 1;
+            if (preceding->first + preceding->count == it->first) {
+                preceding->count += it->count;
+                it = freeList.erase(it) - 1;
+            }
+        }
+
+        // Hole at the very end: hand it back to the end of the arena
+        if (it->first + it->count == used) {
+            used = it->first;
+            freeList.erase(it);
+        }
+    }
+
+    // Arena for a vertex format / index type pair (also its sort slot)
+    static uint32_t arenaIndex(VertexFormat format, GLenum indexType) {
+        return static_cast<uint32_t>(format) * 2 + (indexType == GL_UNSIGNED_SHORT ? 0 : 1);
+    }
+
+    void createArena(MeshArena& arena, VertexFormat format, GLenum indexType) {
+        arena.format = format;
+        arena.indexType = indexType;
+        glGenVertexArrays(1, &arena.vao);
+        arena.vbo = createArenaBuffer(ARENA_INITIAL_VERTICES * vertexStride(format));
+        arena.ibo = createArenaBuffer(ARENA_INITIAL_INDICES * indexSize(indexType));
+        arena.vertexCapacity = ARENA_INITIAL_VERTICES;
+        arena.indexCapacity = ARENA_INITIAL_INDICES;
+        bindArenaBuffers(arena);
+    }
+
+    // Grow (double) until the requested counts fit. Old contents are copied
+    // GPU-side with glCopyBufferSubData - no round trip through the CPU.
+    void reserveArena(MeshArena& arena, size_t vertexCount, size_t indexCount) {
+        bool grown = false;
+        size_t stride = vertexStride(arena.format);
+
+        if (vertexCount > arena.vertexCapacity) {
+            size_t capacity = arena.vertexCapacity;
+            while (capacity < vertexCount) capacity *= 2;
+            arena.vbo = growArenaBuffer(arena.vbo, arena.vertexCount * stride,
+                                        capacity * stride);
+            arena.vertexCapacity = capacity;
+            grown = true;
+        }
+        if (indexCount > arena.indexCapacity) {
+            size_t capacity = arena.indexCapacity;
+            while (capacity < indexCount) capacity *= 2;
+            arena.ibo = growArenaBuffer(arena.ibo, arena.indexCount * indexSize(arena.indexType),
+                                        capacity * indexSize(arena.indexType));
+            arena.indexCapacity = capacity;
+            grown = true;
+        }
+
+        if (grown) {
+            bindArenaBuffers(arena);  // The VAO still points at the old buffers
+        }
+    }
+
+    static GLuint createArenaBuffer(size_t bytes) {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    static GLuint growArenaBuffer(GLuint oldBuffer, size_t usedBytes, size_t newBytes) {
+        GLuint newBuffer = createArenaBuffer(newBytes);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            static_cast<GLsizeiptr>(usedBytes));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glDeleteBuffers(1, &oldBuffer);
+        return newBuffer;
+    }
+
+    // (Re)attach the arena buffers to the arena VAO
+    void bindArenaBuffers(const MeshArena& arena) {
+        state.bindVertexArray(arena.vao);
+
+        glBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+        setVertexAttributes(arena.format);
+        setInstanceAttributes(0);
+
+        // The element buffer binding is VAO state
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.ibo);
+
+        state.bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // ==========================================================================
+    // VERTEX ATTRIBUTES (VAO and vertex buffer must be bound)
+    // Tell GPU how to interpret vertex data
+    // ==========================================================================
+    void setVertexAttributes(VertexFormat format) {
+        if (format == VertexFormat::Packed) {
+            setPackedVertexAttributes();
+            return;
+        }
 
         // Position (location = 0 in vertex shader)
         glEnableVertexAttribArray(0);
@@ -477,31 +1996,63 @@ private:
             sizeof(Vertex),
             (void*)offsetof(Vertex, color)
         );
+    }
 
-        // ======================================================================
-        // CREATE AND FILL INDEX BUFFER (IBO / EBO)
-        // Upload triangle indices to GPU
-        // ======================================================================
-        glGenBuffers(1, &gpuMesh.ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.ibo);
+    // PackedVertex: same locations, the GPU converts each field to floats
+    // - position: 3 x unorm16 → 0-1 within the mesh box
+    // - normal:   10_10_10_2 snorm → (octahedral x, y, 0, -1), see decodeNormal
+    // - color:    RGBA8 unorm, like Vertex
+    void setPackedVertexAttributes() {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex),
+                              (void*)offsetof(PackedVertex, position));
 
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     mesh.indices.size() * sizeof(uint32_t),
-                     mesh.indices.data(),
-                     GL_STATIC_DRAW);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex),
+                              (void*)offsetof(PackedVertex, normal));
 
-        gpuMesh.indexCount = static_cast<GLsizei>(mesh.indices.size());
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex),
+                              (void*)offsetof(PackedVertex, color));
+    }
 
-        // Unbind
-        glBindVertexArray(0);
+    // ==========================================================================
+    // INSTANCE ATTRIBUTES (VAO must be bound)
+    // Point locations 3-11 at InstanceData records in the stream buffer,
+    // starting at byte `offset`.
+    // Divisor 1 = advance once per instance, not per vertex.
+    // A mat4 is 4 vec4 attributes, a mat3 is 3 vec3 attributes.
+    // ==========================================================================
+    void setInstanceAttributes(GLintptr offset) {
+        // Attribute "pointers" are byte offsets into the bound buffer
+        auto at = [offset](size_t field) {
+            return reinterpret_cast<const void*>(offset + static_cast<GLintptr>(field));
+        };
+
+        glBindBuffer(GL_ARRAY_BUFFER, stream.getBuffer());
+        for (GLuint column = 0; column < 4; column++) {
+            GLuint location = 3 + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  at(offsetof(InstanceData, model) + column * 4 * sizeof(float)));
+            glVertexAttribDivisor(location, 1);
+        }
+        for (GLuint column = 0; column < 3; column++) {
+            GLuint location = 7 + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  at(offsetof(InstanceData, normalMatrix) + column * 3 * sizeof(float)));
+            glVertexAttribDivisor(location, 1);
+        }
+        glEnableVertexAttribArray(10);
+        glVertexAttribPointer(10, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(InstanceData),
+                              at(offsetof(InstanceData, color)));
+        glVertexAttribDivisor(10, 1);
+        glEnableVertexAttribArray(11);
+        glVertexAttribPointer(11, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              at(offsetof(InstanceData, emissive)));
+        glVertexAttribDivisor(11, 1);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-        // Store for later use
-        uploadedMeshes[&mesh] = gpuMesh;
-
-        std::cout << "Uploaded mesh: " << mesh.vertices.size() << " vertices, "
-                  << mesh.getTriangleCount() << " triangles" << std::endl;
     }
 
     // ==========================================================================
@@ -40,20 +40,57 @@ const char* VERTEX_SHADER = R"(
 // INPUT ATTRIBUTES (from CPU vertex buffer)
 // layout(location = X) matches glVertexAttribPointer calls
 // =============================================================================
-layout(location = 0) in vec3 aPosition;  // Vertex position (object space)
-layout(location = 1) in vec3 aNormal;    // Vertex normal (object space)
+layout(location = 0) in vec3 aPosition;  // Vertex position (object space, or 0-1 in the box if packed)
+layout(location = 1) in vec4 aNormal;    // Vertex normal (object space), see decodeNormal
 layout(location = 2) in vec3 aColor;     // Vertex color (RGB, 0-1 range)
 
 // =============================================================================
-// UNIFORMS (constant for all vertices in a draw call)
-// These are set from CPU with glUniform* calls
+// PER-FRAME UNIFORM BLOCK (std140, binding point 0)
+// Filled ONCE per frame by RendererGL::beginFrame and shared by every
+// program that declares it - no per-draw uploads of camera/light state.
+// Must match RendererGL::FrameUniforms byte for byte (and the FS copy).
+// Members are used by name directly, no block prefix.
 // =============================================================================
-uniform mat4 uModel;       // Model matrix (object → world)
-uniform mat4 uView;        // View matrix (world → camera)
-uniform mat4 uProjection;  // Projection matrix (camera → clip space)
+layout(std140) uniform FrameData {
+    mat4 uView;                  // View matrix (world → camera)
+    mat4 uProjection;            // Projection matrix (camera → clip space)
+    mat4 uCascadeMatrices[4];    // World → each shadow cascade's clip space
+    vec4 uCascadeSplits;         // View distance where each cascade ends
+    vec3 uLightDir;              // Light direction (world space)
+    float uAmbient;              // Ambient light amount (0-1), packs after the vec3
+    int uCascadeCount;           // Cascades in use (1-4)
+};
+
+// =============================================================================
+// PER-DRAW UNIFORM BLOCK (std140, binding point 2)
+// One record per draw in RendererGL's stream buffer; each draw binds its
+// own record's range. Must match RendererGL::DrawUniforms.
+// =============================================================================
+layout(std140) uniform DrawData {
+    mat4 uModel;          // Model matrix (object → world)
+    mat3 uNormalMatrix;   // Inverse-transpose of mat3(uModel), see Mat4::normalMatrix
+    float uEmissive;      // 1.0 = object emits light (unlit, self-illuminated)
+};
 
 // We could combine into MVP on CPU, but keeping separate for clarity
 
+// =============================================================================
+// NORMAL DECODING (see PackedVertex.h)
+// Float vertices: xyz is the normal, w is missing and reads as 1.0
+// Packed vertices: xy is an octahedral encoding, w = -1
+// (Packed positions need nothing here: RendererGL folds the box
+// dequantization into uModel)
+// =============================================================================
+vec3 decodeNormal(vec4 normal) {
+    if (normal.w >= 0.0) return normal.xyz;
+
+    vec3 n = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));
+    float t = max(-n.z, 0.0);   // Lower hemisphere: unfold the corners
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 // =============================================================================
 // OUTPUTS (passed to fragment shader)
 // GPU automatically interpolates these across triangle
@@ -61,12 +98,7 @@ uniform mat4 uProjection;  // Projection matrix (camera → clip space)
 out vec3 fragColor;      // Color (interpolated per-pixel)
 out vec3 fragNormal;     // Normal (interpolated per-pixel)
 out vec3 fragWorldPos;   // World position (for shadow mapping)
-out vec4 fragLightSpace; // Position in light's clip space (for shadow mapping)
-
-// =============================================================================
-// UNIFORMS for shadow mapping
-// =============================================================================
-uniform mat4 uLightSpaceMatrix;  // Light's view-projection matrix
+flat out float fragEmissive; // 1.0 = unlit (see fragment shader); "flat" = no interpolation
 
 // =============================================================================
 // MAIN FUNCTION
@@ -89,21 +121,17 @@ void main() {
     // ==========================================================================
     fragWorldPos = vec3(uModel * vec4(aPosition, 1.0));
 
-    // ==========================================================================
-    // LIGHT SPACE POSITION
-    // Transform to light's clip space for shadow map lookup
-    // ==========================================================================
-    fragLightSpace = uLightSpaceMatrix * vec4(fragWorldPos, 1.0);
-
     // ==========================================================================
     // NORMAL TRANSFORMATION
     // Transform normal from object space to world space
     // This is what we do in Renderer3D.h:140:
     //   Vec3 worldNormal = modelMatrix.transformDirection(objectNormal)
     //
-    // mat3(uModel) extracts rotation/scale, discards translation (correct for normals)
+    // mat3(uModel) would skew normals under non-uniform scale (floor/wall
+    // slabs); the inverse-transpose keeps them perpendicular to the surface.
+    // Computed once per draw on the CPU instead of per vertex here.
     // ==========================================================================
-    fragNormal = normalize(mat3(uModel) * aNormal);
+    fragNormal = normalize(uNormalMatrix * decodeNormal(aNormal));
 
     // ==========================================================================
     // PASS COLOR TO FRAGMENT SHADER
@@ -111,6 +139,75 @@ void main() {
     // (This is what barycentric coordinates do in our software renderer)
     // ==========================================================================
     fragColor = aColor;
+    fragEmissive = uEmissive;
+}
+)";
+
+// =============================================================================
+// INSTANCED VERTEX SHADER
+// =============================================================================
+// Same math as VERTEX_SHADER, but the per-object values come from VERTEX
+// ATTRIBUTES instead of uniforms. The instance buffer holds one record per
+// object; glVertexAttribDivisor(loc, 1) tells the GPU to advance those
+// attributes once per INSTANCE instead of once per vertex.
+//
+// So one glDrawElementsInstanced draws N copies of the mesh, each with its
+// own transform, color and emissive flag - one draw call instead of N
+// (and no uniform uploads in between).
+//
+// A mat4 attribute occupies 4 consecutive locations (one per column),
+// a mat3 occupies 3.
+// =============================================================================
+
+const char* INSTANCED_VERTEX_SHADER = R"(
+#version 330 core
+
+// Per-vertex (same buffer layouts as VERTEX_SHADER)
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec4 aNormal;
+layout(location = 2) in vec3 aColor;
+
+// Per-instance (divisor = 1)
+layout(location = 3)  in mat4 aModel;          // Locations 3-6
+layout(location = 7)  in mat3 aNormalMatrix;   // Locations 7-9
+layout(location = 10) in vec4 aInstanceColor;  // rgb + weight (a = 0: keep vertex color)
+layout(location = 11) in float aEmissive;      // 1.0 = unlit
+
+// Same block as VERTEX_SHADER (no per-draw uniforms at all)
+layout(std140) uniform FrameData {
+    mat4 uView;
+    mat4 uProjection;
+    mat4 uCascadeMatrices[4];
+    vec4 uCascadeSplits;
+    vec3 uLightDir;
+    float uAmbient;
+    int uCascadeCount;
+};
+
+out vec3 fragColor;
+out vec3 fragNormal;
+out vec3 fragWorldPos;
+flat out float fragEmissive;
+
+// Same as VERTEX_SHADER's
+vec3 decodeNormal(vec4 normal) {
+    if (normal.w >= 0.0) return normal.xyz;
+
+    vec3 n = vec3(normal.xy, 1.0 - abs(normal.x) - abs(normal.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec4 worldPos = aModel * vec4(aPosition, 1.0);
+    gl_Position = uProjection * uView * worldPos;
+
+    fragWorldPos = worldPos.xyz;
+    fragNormal = normalize(aNormalMatrix * decodeNormal(aNormal));
+    fragColor = mix(aColor, aInstanceColor.rgb, aInstanceColor.a);
+    fragEmissive = aEmissive;
 }
 )";
 
@@ -136,15 +233,24 @@ const char* FRAGMENT_SHADER = R"(
 in vec3 fragColor;       // Interpolated color
 in vec3 fragNormal;      // Interpolated normal (NOT normalized after interpolation)
 in vec3 fragWorldPos;    // Interpolated world position
-in vec4 fragLightSpace;  // Interpolated light-space position
+flat in float fragEmissive; // Per draw (DrawData) or per instance
 
 // =============================================================================
-// UNIFORMS (constant for all pixels in a draw call)
+// UNIFORMS
+// Light and cascade state come from the per-frame block (declared
+// identically in the vertex shader - one block, shared across both stages)
 // =============================================================================
-uniform vec3 uLightDir;       // Light direction (world space)
-uniform float uAmbient;       // Ambient light amount (0-1)
-uniform bool uEmissive;       // If true, object emits light (unlit, self-illuminated)
-uniform sampler2D uShadowMap; // Shadow map texture (depth from light's POV)
+layout(std140) uniform FrameData {
+    mat4 uView;
+    mat4 uProjection;
+    mat4 uCascadeMatrices[4];    // World → cascade clip space
+    vec4 uCascadeSplits;         // View distance where cascade i ends
+    vec3 uLightDir;              // Light direction (world space)
+    float uAmbient;              // Ambient light amount (0-1)
+    int uCascadeCount;
+};
+
+uniform sampler2DArray uShadowMap; // One depth layer per cascade (from light's POV), unit 0
 
 // =============================================================================
 // OUTPUT
@@ -152,11 +258,35 @@ uniform sampler2D uShadowMap; // Shadow map texture (depth from light's POV)
 // =============================================================================
 out vec4 finalColor;
 
+// =============================================================================
+// CASCADE SELECTION
+// Cascades are ordered near → far; use the first one whose slice of the
+// view frustum still contains this fragment. -1 = beyond the last cascade
+// (no shadow information there).
+// =============================================================================
+int selectCascade(vec3 worldPos) {
+    float viewDepth = -(uView * vec4(worldPos, 1.0)).z;  // Camera looks down -Z
+    for (int i = 0; i < uCascadeCount; i++) {
+        if (viewDepth < uCascadeSplits[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 // =============================================================================
 // SHADOW CALCULATION FUNCTION
-// Determines if this fragment is in shadow by comparing depth with shadow map
+// Determines if this fragment is in shadow by comparing depth with the
+// shadow map of the cascade it falls into
 // =============================================================================
-float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir) {
+float calculateShadow(vec3 worldPos, vec3 normal, vec3 lightDir) {
+    int cascade = selectCascade(worldPos);
+    if (cascade < 0) {
+        return 0.0;  // Past the shadow distance: lit
+    }
+    mat4 lightSpace = uCascadeMatrices[cascade];
+    vec4 fragPosLightSpace = lightSpace * vec4(worldPos, 1.0);
+
     // ==========================================================================
     // PERSPECTIVE DIVIDE
     // Convert from clip space [-w, w] to NDC [-1, 1]
@@ -181,7 +311,7 @@ float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir) {
     // SAMPLE SHADOW MAP
     // Get the depth value stored from light's perspective
     // ==========================================================================
-    float closestDepth = texture(uShadowMap, projCoords.xy).r;
+    float closestDepth = texture(uShadowMap, vec3(projCoords.xy, float(cascade))).r;
 
     // ==========================================================================
     // CURRENT FRAGMENT DEPTH
@@ -193,8 +323,16 @@ float calculateShadow(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir) {
     // SHADOW BIAS
     // Prevents "shadow acne" (self-shadowing artifacts)
     // Larger bias for surfaces perpendicular to light
+    //
+    // Every cascade has its own texel size and depth range, so the bias is
+    // picked in WORLD units (a few texels of this cascade) and converted
+    // with the cascade's depth scale. The matrix's rows give both:
+    // |row 0| = 1 / half-width, |row 2| = 2 / depth range (rotation-only view)
     // ==========================================================================
-    float bias = max(0.005 * (1.0 - dot(normal, lightDir)), 0.001);
+    float mapSize = float(textureSize(uShadowMap, 0).x);
+    float texelWorld = 2.0 / (mapSize * length(vec3(lightSpace[0][0], lightSpace[1][0], lightSpace[2][0])));
+    float depthPerUnit = 0.5 * length(vec3(lightSpace[0][2], lightSpace[1][2], lightSpace[2][2]));
+    float bias = texelWorld * mix(1.0, 3.0, 1.0 - dot(normal, lightDir)) * depthPerUnit;
 
     // ==========================================================================
     // SHADOW TEST
@@ -217,7 +355,7 @@ void main() {
     // If object is emissive (like a light source), skip lighting calculations
     // and just output the color at full brightness
     // ==========================================================================
-    if (uEmissive) {
+    if (fragEmissive > 0.5) {
         finalColor = vec4(fragColor, 1.0);
         return;
     }
@@ -235,7 +373,7 @@ void main() {
     // CALCULATE SHADOW
     // 0.0 = fully lit, 1.0 = fully shadowed
     // ==========================================================================
-    float shadow = calculateShadow(fragLightSpace, litNormal, uLightDir);
+    float shadow = calculateShadow(fragWorldPos, litNormal, uLightDir);
 
     // ==========================================================================
     // LAMBERTIAN DIFFUSE LIGHTING
@@ -293,8 +431,19 @@ const char* SHADOW_VERTEX_SHADER = R"(
 
 layout(location = 0) in vec3 aPosition;
 
-uniform mat4 uLightSpaceMatrix;  // Combined light view-projection matrix
-uniform mat4 uModel;             // Model matrix
+// Per-pass block (std140, binding point 1): one record per cascade,
+// filled once per frame; each cascade's pass binds its own record
+layout(std140) uniform ShadowPassData {
+    mat4 uLightSpaceMatrix;  // This cascade's light view-projection matrix
+};
+
+// Per-draw block (binding point 2), same record as the main pass;
+// only uModel is read here
+layout(std140) uniform DrawData {
+    mat4 uModel;             // Model matrix
+    mat3 uNormalMatrix;
+    float uEmissive;
+};
 
 void main() {
     // Transform vertex to light's clip space
@@ -303,6 +452,22 @@ void main() {
 }
 )";
 
+// Instanced variant: model matrix per instance (locations 3-6, divisor 1)
+const char* INSTANCED_SHADOW_VERTEX_SHADER = R"(
+#version 330 core
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 3) in mat4 aModel;
+
+layout(std140) uniform ShadowPassData {
+    mat4 uLightSpaceMatrix;
+};
+
+void main() {
+    gl_Position = uLightSpaceMatrix * aModel * vec4(aPosition, 1.0);
+}
+)";
+
 const char* SHADOW_FRAGMENT_SHADER = R"(
 #version 330 core
 
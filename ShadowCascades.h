@@ -0,0 +1,145 @@
+#pragma once
+#include "Camera.h"
+#include "Mat4.h"
+#include "Vec3.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// =============================================================================
+// ShadowCascades: Split the camera frustum, give each slice its own shadow map
+// =============================================================================
+// THE PROBLEM WITH ONE SHADOW MAP:
+// A single map has to cover everything the camera can see. Near the camera
+// one shadow texel then covers many screen pixels (blocky shadows), while
+// far away many texels land in one pixel (wasted resolution).
+//
+// CASCADES:
+// Cut the view frustum into slices along the view direction and render
+// one shadow map per slice, each fitted to just its slice:
+//
+//   camera ▷ |c0| c1 |   c2   |       c3        |   ← view distance
+//            near                              far
+//
+// Near slices are short, so their maps are dense; far slices are long but
+// far away. Every map has the same resolution.
+//
+// SPLIT DISTANCES ("practical split scheme"):
+// - uniform:     near + (far - near) * i/N       (wastes the near range)
+// - logarithmic: near * (far / near)^(i/N)       (ideal density, tiny c0)
+// - practical:   lambda * log + (1 - lambda) * uniform
+//
+// STABLE FITTING (no shimmering):
+// As the camera moves, a tight box around the slice would change size and
+// slide by fractions of a texel, so shadow edges crawl. Instead:
+// 1. Fit a SPHERE around the slice: its radius doesn't change when the
+//    camera rotates, so the map's world-space size stays constant
+// 2. Use a light view that only depends on the light direction
+// 3. Snap the sphere's center to whole texels in light space, so the map
+//    moves in texel steps and every texel keeps sampling the same world
+//    positions
+// =============================================================================
+
+struct ShadowCascades {
+    static constexpr int MAX_CASCADES = 4;
+
+    struct Settings {
+        int count = 3;               // Number of cascades (1 to MAX_CASCADES)
+        int resolution = 1024;       // Texels per side of each cascade's map
+        float lambda = 0.75f;        // 0 = uniform splits, 1 = logarithmic
+        float maxDistance = 0.0f;    // Shadowed view distance (0 = camera far plane)
+        float casterMargin = 50.0f;  // Depth kept toward the light, for casters outside the slice
+    };
+
+    int count = 0;
+    std::array<Mat4, MAX_CASCADES> lightSpace;   // World → cascade clip space
+    std::array<float, MAX_CASCADES> splitFar{};  // View distance where each cascade ends
+
+    // ==========================================================================
+    // COMPUTE
+    // lightDirection points TOWARD the light (normalized)
+    // ==========================================================================
+    static ShadowCascades compute(const Camera& camera, const Vec3& lightDirection,
+                                  const Settings& settings) {
+        ShadowCascades cascades;
+        cascades.count = std::clamp(settings.count, 1, MAX_CASCADES);
+
+        float near = camera.getNearPlane();
+        float far = camera.getFarPlane();
+        if (settings.maxDistance > near) {
+            far = std::min(far, settings.maxDistance);
+        }
+
+        // Frustum axes: a point at view distance d spans ±tanX*d, ±tanY*d
+        Vec3 eye = camera.getPosition();
+        Vec3 forward = camera.getForward();
+        Vec3 right = camera.getRight();
+        Vec3 up = camera.getUpVector();
+        float tanY = std::tan(camera.getFOV() * 0.5f);
+        float tanX = tanY * camera.getAspectRatio();
+
+        // Rotation-only light view (looking along the light's travel)
+        Vec3 lightUp = std::fabs(lightDirection.y) > 0.99f ? Vec3(0, 0, 1) : Vec3(0, 1, 0);
+        Mat4 lightView = Mat4::lookAt(Vec3(0, 0, 0), -lightDirection, lightUp);
+
+        float sliceNear = near;
+        for (int i = 0; i < cascades.count; i++) {
+            // ==================================================================
+            // SPLIT
+            // ==================================================================
+            float t = static_cast<float>(i + 1) / static_cast<float>(cascades.count);
+            float logSplit = near * std::pow(far / near, t);
+            float uniformSplit = near + (far - near) * t;
+            float sliceFar = settings.lambda * logSplit + (1.0f - settings.lambda) * uniformSplit;
+
+            // ==================================================================
+            // BOUNDING SPHERE OF THE SLICE
+            // The corners' centroid lies on the view axis, so the radius is
+            // the same for every camera orientation. Rounding it up keeps
+            // float noise from changing the map size frame to frame.
+            // ==================================================================
+            std::array<Vec3, 8> corners;
+            Vec3 center(0, 0, 0);
+            for (int k = 0; k < 8; k++) {
+                float d = k < 4 ? sliceNear : sliceFar;
+                float sx = (k & 1) ? 1.0f : -1.0f;
+                float sy = (k & 2) ? 1.0f : -1.0f;
+                corners[k] = eye + forward * d + right * (sx * tanX * d) + up * (sy * tanY * d);
+                center += corners[k];
+            }
+            center = center / 8.0f;
+
+            float radius = 0.0f;
+            for (const Vec3& corner : corners) {
+                radius = std::max(radius, (corner - center).length());
+            }
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+
+            // ==================================================================
+            // TEXEL SNAPPING
+            // Move the center to a whole multiple of one texel's world size
+            // (the map spans 2 * radius over `resolution` texels)
+            // ==================================================================
+            Vec3 lightCenter = lightView.transformPoint(center);
+            float texel = 2.0f * radius / static_cast<float>(settings.resolution);
+            lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+            lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+
+            // View space looks down -Z: depth along the light is -z.
+            // The near side extends toward the light so casters between
+            // the light and the slice still land in the map.
+            float depth = -lightCenter.z;
+            Mat4 lightProjection = Mat4::ortho(
+                lightCenter.x - radius, lightCenter.x + radius,
+                lightCenter.y - radius, lightCenter.y + radius,
+                depth - radius - settings.casterMargin, depth + radius
+            );
+
+            cascades.lightSpace[i] = lightProjection * lightView;
+            cascades.splitFar[i] = sliceFar;
+            sliceNear = sliceFar;
+        }
+
+        return cascades;
+    }
+};
@@ -0,0 +1,238 @@
+#pragma once
+#include <GL/glew.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// =============================================================================
+// StreamBuffer: Ring buffer for data the CPU writes EVERY frame
+// =============================================================================
+// THE PROBLEM:
+// Per-draw data (model matrices, instance records) changes every frame.
+// glUniform* / glBufferSubData copy it through the driver one call at a
+// time, and overwriting a buffer the GPU may still be reading forces the
+// driver to either stall or secretly copy.
+//
+// THE RING:
+// One big buffer split into FRAME_COUNT regions (triple buffering):
+//
+//   [ frame N-2 (GPU reading) | frame N-1 (GPU queued) | frame N (CPU writing) ]
+//
+// The CPU only ever writes into the current frame's region, bumping a head
+// offset per allocation. When a frame ends we drop a FENCE into the GPU
+// command stream; before reusing a region three frames later we wait on
+// its fence. Normally that fence signalled long ago, so the wait is free.
+//
+// Draws then point INTO the ring (glBindBufferRange offset, vertex
+// attribute offset / base instance) instead of uploading anything.
+//
+// TWO WAYS TO WRITE:
+// - Persistent mapping (ARB_buffer_storage / GL 4.4): map once, keep the
+//   pointer forever. Writes go straight to GPU-visible memory; COHERENT
+//   means no flush calls are needed. Zero GL calls per allocation.
+// - Fallback (core 3.3): allocations are written into a CPU staging copy
+//   of the region and uploaded by commit with one glBufferSubData each.
+//   Mapping can't work here: without PERSISTENT a buffer can't be drawn
+//   from while mapped, nor mapped twice - and a frame holds several
+//   allocations at once and draws between them.
+//
+// GROWING:
+// An allocation that doesn't fit the region's remainder replaces the
+// whole ring with one at least twice as big, starting empty (the old
+// buffer is deleted; GL keeps its storage alive until in-flight draws
+// finish). Allocations already drawn from are unaffected. Ones NOT yet
+// drawn from would be lost - so code that writes several allocations
+// before drawing any reserves their total first. The buffer name may
+// change: bind getBuffer() at draw time, and re-point anything that
+// stores it when getGeneration() changes.
+// =============================================================================
+
+class StreamBuffer {
+public:
+    static constexpr int FRAME_COUNT = 3;
+
+    // One allocation: write `data`, then call commit
+    struct Allocation {
+        void* data;          // CPU write pointer (write-only memory: never read it)
+        GLintptr offset;     // Byte offset in getBuffer()
+        size_t size;
+    };
+
+private:
+    GLuint buffer = 0;
+    size_t frameSize;                // Bytes per region
+    bool persistent = false;
+    uint8_t* mapped = nullptr;       // Whole-buffer mapping (persistent mode only)
+    std::vector<uint8_t> staging;    // Current region's CPU copy (fallback only)
+    uint32_t generation = 0;         // Bumped whenever the buffer is replaced
+
+    std::array<GLsync, FRAME_COUNT> fences{};
+    int frame = 0;                   // Region the CPU is writing
+    size_t head = 0;                 // Next free byte in that region
+
+public:
+    explicit StreamBuffer(size_t bytesPerFrame) : frameSize(bytesPerFrame) {
+        persistent = GLEW_ARB_buffer_storage != 0;
+        createStorage();
+
+        std::cout << "Stream buffer: " << FRAME_COUNT << " x " << frameSize / 1024 << " KB ("
+                  << (persistent ? "persistent mapped" : "staged, glBufferSubData per allocation") << ")"
+                  << std::endl;
+    }
+
+    ~StreamBuffer() {
+        destroyStorage();
+    }
+
+    // Owns a GL buffer and fences
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    GLuint getBuffer() const { return buffer; }
+    uint32_t getGeneration() const { return generation; }
+    bool isPersistent() const { return persistent; }
+
+    // ==========================================================================
+    // NEXT FRAME
+    // Fence the region we just filled, move to the next one and make sure
+    // the GPU is done with it (it was written FRAME_COUNT frames ago).
+    // ==========================================================================
+    void nextFrame() {
+        fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        frame = (frame + 1) % FRAME_COUNT;
+        head = 0;
+        waitForFence(fences[frame]);
+    }
+
+    // ==========================================================================
+    // ALLOCATE
+    // Reserve `size` bytes at an offset that is a multiple of `alignment`
+    // (UBO ranges need GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, instance data
+    // needs a whole number of records for base-instance addressing).
+    // ==========================================================================
+    Allocation allocate(size_t size, size_t alignment) {
+        size_t offset = alignUp(frameStart() + head, alignment);
+        if (offset + size > frameStart() + frameSize) {
+            grow(size + alignment);
+            offset = alignUp(frameStart(), alignment);
+        }
+
+        head = offset + size - frameStart();
+
+        uint8_t* data = persistent ? mapped + offset : staging.data() + (offset - frameStart());
+        return {data, static_cast<GLintptr>(offset), size};
+    }
+
+    // ==========================================================================
+    // RESERVE
+    // Make sure the next allocations totalling `bytes` (alignment padding
+    // included) fit without growing - call before writing several
+    // allocations that are drawn from only after all are written.
+    // ==========================================================================
+    void reserve(size_t bytes) {
+        if (head + bytes > frameSize) {
+            grow(bytes);
+        }
+    }
+
+    // Finish writing an allocation (must happen before it is drawn from)
+    void commit(const Allocation& allocation) {
+        if (persistent) return;  // Coherent mapping: writes are already visible
+
+        const uint8_t* data = static_cast<const uint8_t*>(allocation.data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset,
+                        static_cast<GLsizeiptr>(allocation.size), data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+private:
+    size_t frameStart() const {
+        return static_cast<size_t>(frame) * frameSize;
+    }
+
+    // ==========================================================================
+    // STORAGE
+    // ==========================================================================
+    void createStorage() {
+        GLsizeiptr totalSize = static_cast<GLsizeiptr>(frameSize * FRAME_COUNT);
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);  // Neutral target: touches no VAO/UBO state
+
+        if (persistent) {
+            // Immutable storage: the size can never change, which is what
+            // allows the driver to let us keep the pointer while drawing
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+            mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags));
+            if (mapped == nullptr) {
+                // Immutable storage can't be respecified: start over with a
+                // fresh buffer for the fallback
+                persistent = false;
+                glDeleteBuffers(1, &buffer);
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            }
+        }
+        if (!persistent) {
+            glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+            staging.resize(frameSize);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        generation++;
+    }
+
+    void destroyStorage() {
+        for (GLsync& fence : fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (mapped) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            mapped = nullptr;
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+    // Replace the ring with one whose regions hold at least `bytes`
+    // (see GROWING above). The new ring has no fences: nothing uses it yet.
+    void grow(size_t bytes) {
+        size_t newFrameSize = frameSize * 2;
+        while (newFrameSize < bytes) newFrameSize *= 2;
+
+        std::cerr << "WARNING: stream buffer frame budget (" << frameSize / 1024
+                  << " KB) exceeded, growing to " << newFrameSize / 1024 << " KB per frame" << std::endl;
+
+        destroyStorage();
+        frameSize = newFrameSize;
+        frame = 0;
+        head = 0;
+        createStorage();
+    }
+
+    static size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static void waitForFence(GLsync& fence) {
+        if (!fence) return;
+
+        // FLUSH_COMMANDS makes sure the fence itself reaches the GPU
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;) {
+            GLenum result = glClientWaitSync(fence, flags, 1000000000);  // 1 s
+            if (result != GL_TIMEOUT_EXPIRED) break;  // Signalled (or lost: don't hang)
+            flags = 0;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+};
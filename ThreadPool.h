@@ -0,0 +1,148 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// =============================================================================
+// ThreadPool: Persistent worker threads for data-parallel loops
+// =============================================================================
+// WHY A POOL?
+// Creating a std::thread costs tens of microseconds (kernel call, stack
+// allocation). A renderer wants to go wide several times per frame, so we
+// create the workers ONCE and park them on a condition variable between jobs.
+//
+// THE ONLY OPERATION: parallelFor(count, fn)
+// - Calls fn(i) for every i in [0, count)
+// - Indices are handed out through one atomic counter, so a worker that
+//   finishes a cheap item immediately grabs the next one (dynamic load
+//   balancing - important when some screen tiles are much busier than others)
+// - The calling thread works too, then blocks until every item is done
+//
+// THREAD SAFETY:
+// parallelFor itself must only be called from one thread at a time.
+// fn must be safe to run concurrently for DIFFERENT indices.
+// =============================================================================
+
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable jobReady;   // Workers wait here for work
+    std::condition_variable jobDone;    // Caller waits here for completion
+
+    // Current job (valid while activeWorkers > 0 or the caller is inside parallelFor)
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextIndex{0};
+
+    size_t generation = 0;      // Bumped per job so workers never run one twice
+    unsigned activeWorkers = 0; // Workers still chewing on the current job
+    bool stopping = false;
+
+public:
+    // ==========================================================================
+    // CONSTRUCTOR
+    // threadCount = total threads working on a job, INCLUDING the caller.
+    // So ThreadPool(1) spawns nothing and runs everything inline.
+    // ==========================================================================
+    explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency()) {
+        threadCount = std::max(1u, threadCount);
+        workers.reserve(threadCount - 1);
+        for (unsigned i = 1; i < threadCount; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Non-copyable: owns OS threads
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned getThreadCount() const {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    // ==========================================================================
+    // PARALLEL FOR
+    // Blocks until fn has been called for every index in [0, count)
+    // ==========================================================================
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+        if (count == 0) return;
+
+        // Nothing to share: skip all synchronization
+        if (workers.empty() || count == 1) {
+            for (size_t i = 0; i < count; i++) fn(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobCount = count;
+            nextIndex.store(0, std::memory_order_relaxed);
+            activeWorkers = static_cast<unsigned>(workers.size());
+            generation++;
+        }
+        jobReady.notify_all();
+
+        // Caller helps instead of idling
+        runItems(fn, count);
+
+        // Wait for stragglers (fn may still be running on other threads)
+        std::unique_lock<std::mutex> lock(mutex);
+        jobDone.wait(lock, [this] { return activeWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    void runItems(const std::function<void(size_t)>& fn, size_t count) {
+        for (;;) {
+            size_t i = nextIndex.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) break;
+            fn(i);
+        }
+    }
+
+    void workerLoop() {
+        size_t seenGeneration = 0;
+
+        for (;;) {
+            const std::function<void(size_t)>* currentJob;
+            size_t currentCount;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobReady.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+
+                seenGeneration = generation;
+                currentJob = job;
+                currentCount = jobCount;
+            }
+
+            runItems(*currentJob, currentCount);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--activeWorkers == 0) {
+                    jobDone.notify_one();
+                }
+            }
+        }
+    }
+};
@@ -22,11 +22,11 @@
 struct Vec3 {
     float x, y, z;
 
-    Vec3() : x(0), y(0), z(0) {}
-    Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
+    constexpr Vec3() : x(0), y(0), z(0) {}
+    constexpr Vec3(float x, float y, float z) : x(x), y(y), z(z) {}
 
     // Construct from single value (useful for uniform scaling)
-    explicit Vec3(float v) : x(v), y(v), z(v) {}
+    constexpr explicit Vec3(float v) : x(v), y(v), z(v) {}
 
     // ==========================================================================
     // VECTOR ARITHMETIC (same as 2D but with Z)
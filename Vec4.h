@@ -43,12 +43,12 @@
 struct Vec4 {
     float x, y, z, w;
 
-    Vec4() : x(0), y(0), z(0), w(0) {}
-    Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+    constexpr Vec4() : x(0), y(0), z(0), w(0) {}
+    constexpr Vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
 
     // Construct from Vec3 + w
     // Most common: Vec4(position, 1.0f) or Vec4(direction, 0.0f)
-    Vec4(const Vec3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+    constexpr Vec4(const Vec3& v, float w) : x(v.x), y(v.y), z(v.z), w(w) {}
 
     // Explicit conversion to Vec3 (drops w component)
     Vec3 xyz() const {
@@ -167,6 +167,9 @@ public:
         // - nullptr: update entire texture (could update sub-rectangle)
         // - pixels: source data (CPU)
         // - pitch: bytes per row = width * 4 (RGBA)
+        //
+        // getData() is always row-major: a Tiled framebuffer is detiled here,
+        // once per frame, instead of on every rasterizer access
         // ======================================================================
         SDL_UpdateTexture(
             texture,
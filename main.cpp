@@ -20,6 +20,7 @@ int main() {
                         WINDOW_WIDTH, WINDOW_HEIGHT);
 
         RendererGL renderer;  // OpenGL renderer (no framebuffer needed!)
+        renderer.setMeshBatching(true);  // Pack meshes into one buffer → multi-draw per pass
 
         // ======================================================================
         // CREATE CAMERA
@@ -66,6 +67,25 @@ int main() {
         Vec3 lightDirection = Vec3(-0.45f, 0.82f, -0.4f).normalized();
         Mesh lightSource = Mesh::createSphere(0.3f, 10, 10, Color(uint8_t{255}, uint8_t{255}, uint8_t{200}));
 
+        // ======================================================================
+        // OPTIMIZE FOR THE GPU
+        // Reorder triangles/vertices for the vertex cache (see MeshOptimizer.h)
+        // ======================================================================
+        Mesh::OptimizeReport sphereReport = lightSource.optimize();
+        std::cout << "Light sphere ACMR: " << sphereReport.before.acmr << " -> " << sphereReport.after.acmr
+                  << ", ATVR: " << sphereReport.before.atvr << " -> " << sphereReport.after.atvr << std::endl;
+
+        // ======================================================================
+        // UPLOAD TO GPU
+        // Draws refer to meshes by handle from here on
+        // (renderer.releaseMesh frees one when it's no longer needed)
+        // ======================================================================
+        MeshHandle letterBarMesh = renderer.uploadMesh(letterBar);
+        MeshHandle ccFloorMesh = renderer.uploadMesh(ccFloor);
+        MeshHandle ccWallXMesh = renderer.uploadMesh(ccWallX);
+        MeshHandle ccWallZMesh = renderer.uploadMesh(ccWallZ);
+        MeshHandle lightSourceMesh = renderer.uploadMesh(lightSource);
+
         std::cout << "=== Renderer ===" << std::endl;
         std::cout << "Resolution: " << WINDOW_WIDTH << "x" << WINDOW_HEIGHT << std::endl;
         std::cout << "Meshes loaded:" << std::endl;
@@ -147,33 +167,15 @@ int main() {
             }
 
             // ==================================================================
-            // LIGHT SPACE MATRIX
-            // Calculate view and projection matrices from light's perspective
+            // LIGHT SOURCE POSITION
+            // Directional light (like the sun): only its direction matters
+            // for lighting and shadows. The renderer fits the shadow
+            // cascades to the camera itself (see ShadowCascades.h); this
+            // position is just where we draw the light's marker sphere.
             // ==================================================================
-
-            // Light position (far away, directional light like the sun)
             float lightDistance = 15.0f;
             Vec3 lightPos = lightDirection * lightDistance;
 
-            // View matrix from light's perspective (looking at scene center)
-            Mat4 lightView = Mat4::lookAt(
-                lightPos,           // Light position
-                Vec3(0, 0, 0),      // Look at scene center
-                Vec3(0, 1, 0)       // Up vector
-            );
-
-            // Orthographic projection for directional light
-            // Covers area where shadows can be cast
-            float shadowArea = 15.0f;
-            Mat4 lightProjection = Mat4::ortho(
-                -shadowArea, shadowArea,    // Left, right
-                -shadowArea, shadowArea,    // Bottom, top
-                0.1f, 50.0f                 // Near, far
-            );
-
-            // Combined light space matrix (projection * view)
-            Mat4 lightSpaceMatrix = lightProjection * lightView;
-
             // ==================================================================
             // BUILD TRANSFORMATION MATRICES
             // Model Matrix = Translate * Rotate * Scale
@@ -225,40 +227,34 @@ int main() {
                             * Mat4::scale(0.5f);  // Small but visible
 
             // ==================================================================
-            // SHADOW PASS (PASS 1)
-            // Render scene from light's perspective to build shadow map
+            // PER-FRAME STATE
+            // Camera + light uploaded once; every draw below reuses it
             // ==================================================================
-            renderer.beginShadowPass();
-
-            // Render all shadow-casting objects
-            renderer.renderShadowMesh(ccFloor, floorModel, lightSpaceMatrix);
-            renderer.renderShadowMesh(ccWallX, wallXModel, lightSpaceMatrix);
-            renderer.renderShadowMesh(ccWallZ, wallZModel, lightSpaceMatrix);
-            for (const Mat4& segment : letterSegments) {
-                renderer.renderShadowMesh(letterBar, segment, lightSpaceMatrix);
-            }
-            // Don't render light source to shadow map (it's emissive)
-
-            renderer.endShadowPass(WINDOW_WIDTH, WINDOW_HEIGHT);
+            renderer.beginFrame(camera, {.direction = lightDirection, .shadowDistance = 30.0f});
 
             // ==================================================================
-            // NORMAL RENDERING PASS (PASS 2)
-            // Render scene from camera's perspective, using shadow map
+            // RECORD DRAWS
+            // Nothing is drawn yet: the renderer replays this list twice,
+            // sorted by GPU state -
+            //   PASS 1 (shadow): scene from the light's POV → shadow map
+            //                    (per cascade; static casters come from a
+            //                    cache, re-rendered only when it's stale)
+            //   PASS 2 (main):   scene from the camera, using the shadow map
             // ==================================================================
-            window.clear();  // Clear screen for normal rendering
 
-            // Draw corner environment
-            renderer.drawMesh(ccFloor, floorModel, camera, lightSpaceMatrix);
-            renderer.drawMesh(ccWallX, wallXModel, camera, lightSpaceMatrix);
-            renderer.drawMesh(ccWallZ, wallZModel, camera, lightSpaceMatrix);
+            // Corner environment (never moves: cached shadows)
+            renderer.submit(ccFloorMesh, floorModel, {.isStatic = true});
+            renderer.submit(ccWallXMesh, wallXModel, {.isStatic = true});
+            renderer.submit(ccWallZMesh, wallZModel, {.isStatic = true});
 
-            // Draw spinning letter (after walls so it sits in front)
-            for (const Mat4& segment : letterSegments) {
-                renderer.drawMesh(letterBar, segment, camera, lightSpaceMatrix);
-            }
+            // Spinning letter: all three bars share one mesh → one instanced draw
+            renderer.submitInstanced(letterBarMesh, letterSegments);
+
+            // Light source: glows, unaffected by lighting, casts no shadow
+            renderer.submit(lightSourceMesh, lightModel, {.emissive = true, .castsShadow = false});
 
-            // Draw light source (emissive = true, so it glows and isn't affected by lighting)
-            renderer.drawMesh(lightSource, lightModel, camera, lightSpaceMatrix, true);
+            window.clear();  // Clear screen (the shadow map has its own framebuffer)
+            renderer.flush(WINDOW_WIDTH, WINDOW_HEIGHT);
 
             // ==================================================================
             // FPS COUNTER